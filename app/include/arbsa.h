@@ -8,7 +8,11 @@
 
 int arbsa(bool isBaseline,  std::string nodesFile); 
 
-int arbsaMtx(bool isBaseline); // 多线程版本
+int arbsaMtx(bool isBaseline, int numThreads = 0); // 多线程版本，numThreads<=0时按核数
+double calculateStandardDeviation(const std::vector<int> &data);
+std::pair<int, int> getNetCenter(bool isBaseline, Net *net);
+int changeTile(bool isBaseline, std::tuple<int, int, int> originLoc, std::tuple<int, int, int> loc, Instance *inst);
+bool tryUpdatePinDensity(std::tuple<int, int, int> originLoc, std::tuple<int, int, int> loc); // tile改变之后更新pin密度，违反约束时复原并返回false
 // std::tuple<int, int, int> findSuitableLocForLutSet(bool isBaseline, int x, int y, int rangeDesired, Instance *inst);
 // bool isValidForLutorSeqSet(bool isBaseline, int x, int y, int &z, Instance *inst);
 
@@ -17,8 +21,11 @@ bool isValid(bool isBaseline, int x, int y, int &z, Instance *inst);
 
 int newArbsa(bool isBaseline, bool isSeqPack);
 bool isPackValid(bool isBaseline, int x, int y, int &z, Instance *inst, bool isSeqPack);
+bool isPackValidAt(const TileOccupancy &occ, int &z, Instance *inst, bool isSeqPack); // 按给定的占用状态判断
 std::tuple<int, int, int> findPackSuitableLoc(bool isBaseline, int x, int y, int rangeDesired, Instance *inst, bool isSeqPack);
 int changePackTile(bool isBaseline, std::tuple<int, int, int> originLoc, std::tuple<int, int, int> loc, Instance *inst, bool isSeqPack);
-int calculPackRelatedFitness(std::vector<std::pair<int, float>> &fitnessVec, std::map<int, int> &rangeDesiredMap, std::map<int, int> &rangeActualMap, const std::set<int> &instRelatedNetId);
-int calculPackrangeMap(bool isBaseline, std::map<int, int> &rangeActualMap);
-int calculPackRelatedRangeMap(bool isBaseline, std::map<int, int> &rangeActualMap, const std::set<int> &instRelatedNetId);
+int removePackTile(bool isBaseline, std::tuple<int, int, int> originLoc, Instance *inst);
+int addPackTile(bool isBaseline, std::tuple<int, int, int> loc, Instance *inst, bool isSeqPack);
+
+// 并行回火，多个副本在不同温度下同时退火，定期交换温度
+int newArbsaPT(bool isBaseline, bool isSeqPack);
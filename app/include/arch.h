@@ -39,9 +39,12 @@ public:
     }
 
     bool readArch(std::string sclFileName, std::string clkFileName);
+    void createGrid(int numCol, int numRow, int numClockCol, int numClockRow); // 从快照重建时分配tile与时钟区域
+    void clearGrid(); // 释放tile与时钟区域，回到未读入状态
     void reportArch();
 
     void cleanSlots();  // to load placement result 
+    void rebuildTileOccupancy(); // 重建所有tile的占用状态
 
     bool getClockRegionCoordinate(int instCol, int InstRow, int& clockCol, int& clockRow);
 
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "object.h"
+
+/*
+SA的历史最优布局记录
+1、只保存最优cost与上次最优之后接受的移动（inst、一起移动的配对inst、原坐标、新坐标），不复制整个布局
+2、cost刷新最优时清空日志；结束时按相反顺序弹出日志中的移动并撤销，再写回快照，回到最优布局
+3、日志超过上限时压缩成快照：每个移动过的inst只保留第一次移动前的坐标（即最优布局中的坐标），最优cost不变，快照大小不超过inst数
+*/
+class BestTracker
+{
+public:
+    typedef std::pair<Instance *, std::tuple<int, int, int>> SnapshotEntry;
+
+    void begin(int cost);
+    // 接受移动之后调用，matchedInst为一起移动到同一位置的配对inst，没有则为nullptr
+    void recordMove(Instance *inst, Instance *matchedInst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc);
+    // 接受移动并更新cost之后调用，不比最优差则记为新的最优并返回true
+    bool update(int cost);
+
+    int getBestCost() const { return bestCost; }
+    bool isAtBest() const { return moves.empty() && snapshot.empty(); }
+    int getNumMoves() const { return moves.size(); }
+    // 按接受的相反顺序取出一个移动，没有则返回false
+    bool popMove(Instance *&inst, std::tuple<int, int, int> &originLoc, std::tuple<int, int, int> &loc);
+    // 日志弹出完之后，快照中的inst还要写回这里的坐标
+    const std::vector<SnapshotEntry> &getSnapshot() const { return snapshot; }
+
+private:
+    static const int MAX_MOVES = 1 << 20;
+
+    struct Move
+    {
+        Instance *inst;
+        Instance *matchedInst;
+        std::tuple<int, int, int> originLoc;
+        std::tuple<int, int, int> loc;
+    };
+
+    int bestCost = 0;
+    std::vector<Move> moves;
+    std::vector<SnapshotEntry> snapshot;
+    std::vector<char> inSnapshot; // instID -> 是否已在快照中
+
+    void clearLog();
+    void compact();
+    void addSnapshot(Instance *inst, const std::tuple<int, int, int> &loc);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include "object.h"
+
+/*
+PLB空闲位置索引，代替SA中每次移动都枚举窗口内所有坐标
+1、每个PLB tile记录是否还有LUT/SEQ空位（只是必要条件，最终仍由isValid/isPackValid判断）
+2、二维树状数组统计矩形内候选tile数，按列二分 + 列内树状数组下降，O(log^2)取矩形内第k个候选
+3、tile的slot变化后调用updateTile
+*/
+class FreeSiteIndex
+{
+public:
+    enum SiteType
+    {
+        SITE_LUT = 0,
+        SITE_SEQ = 1
+    };
+
+    void build(bool isBaseline);
+    bool isBuilt() const { return built; }
+    void clear() { built = false; }
+
+    void updateTile(int x, int y);
+
+    // 矩形[xl,xr]x[yl,yr]内的候选tile数
+    int count(int type, int xl, int xr, int yl, int yr) const;
+    // 矩形内第k个（从0开始，按列优先）候选tile
+    bool sample(int type, int xl, int xr, int yl, int yr, int k, int &x, int &y) const;
+
+private:
+    bool built = false;
+    bool isBaseline = false;
+    int numCol = 0;
+    int numRow = 0;
+    std::vector<int> tree[2];    // 二维树状数组 (numCol+1)*(numRow+1)
+    std::vector<int> colTree[2]; // 每列一个一维树状数组 numCol*(numRow+1)
+    std::vector<char> flag[2];
+
+    void add(int type, int x, int y, int delta);
+    int prefix(int type, int x, int y) const; // [0,x]x[0,y]
+    int colPrefix(int type, int x, int y) const;
+    bool hasFreeLUT(Tile *tile) const;
+    bool hasFreeSEQ(Tile *tile) const;
+};
+
+extern FreeSiteIndex glbFreeSiteIndex;
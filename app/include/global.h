@@ -6,6 +6,7 @@
 #include "lib.h"
 #include "arch.h"
 #include "rsmt.h"
+#include "pindensity.h"
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
@@ -38,8 +39,8 @@ extern std::map<int, Instance*> glbPackInstMap;    // 存储打包后的全局In
 extern std::map<int, Net*> glbPackNetMap;   // 存储打包后的全局NetMap
 
 
-//全局映射，存放旧netID到新netID的映射
-extern std::map<int, int> oldNetID2newNetID;
+//全局映射，存放旧netID到新netID的映射，下标为旧netID
+extern std::vector<int> oldNetID2newNetID;
 
 
 
@@ -48,7 +49,7 @@ extern std::set<int> glbBigNet; //存储引脚数过大的netid
 extern int glbBigNetPinNum; //bigNet的引脚和 默认为0
 
 /****密度相关****/
-extern std::vector<std::pair<int,int> > glbPinDensity; //第一个是tile x*1000+y 第二个是密度的分子
+extern PinDensityTracker glbPinDensity; //key是tile x*1000+y 值是密度的分子
 extern int glbTopKNum;  //统计PLB的5%数量   setPinDensityMapAndTopValues
 extern int glbInitTopSum; //记录初始top的分子之和
 
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <map>
+#include "object.h"
+
+/*
+LUT配对：共享输入net最多的两个LUT组成LUT组（合并后输入net数不超过6，共享数大于1）
+1、LUT按输入pin数从多到少排序得到rank，每个LUT的输入net存为升序的小数组，net -> LUT存为CSR
+2、按轮次并行，每轮每个未配对的LUT选出最佳候选（共享net数最多，相同时取rank小的）
+3、互相选中的两个LUT配对，用原子标志CAS占用。每轮只读上一轮结束时的状态，结果与线程数和调度无关
+4、线程按批次从原子计数器取任务，负载不均时不会空等
+5、互选配不出新组之后，按rank顺序串行找长度为3的增广路，补回互选比贪心少配的组
+配对结果写入matchedLUTID/LUTSetID和lutGroups，返回配对数
+*/
+int pairLUTs(std::map<int, Instance *> &instMap, int numThreads = 0);
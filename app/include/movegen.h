@@ -0,0 +1,39 @@
+#pragma once
+
+#include <random>
+#include <utility>
+#include <vector>
+#include "netlistcsr.h"
+
+/*
+SA的移动候选生成，基于FlatNetlist的下标数组，生成候选时不分配内存，也不修改netlist
+1、每个net预先存好非固定pin的inst下标（driver与sink，按pin计数），随机选inst只取一个随机数
+2、net中心按net缓存，inst移动被接受后调用instMoved让它所在的net失效，下次用到时重新计算
+inst的fixed标记在SA中不变，重新打包或修改fixed之后需要重新build
+*/
+class MoveGenerator
+{
+public:
+    void build(const FlatNetlist &flat, bool isBaseline);
+    bool isBuilt(const FlatNetlist &flat) const { return this->flat == &flat; }
+    void clear();
+
+    // net上随机选一个非固定的inst，没有时返回nullptr
+    Instance *selectInst(int netIdx, std::mt19937 &rng) const;
+    // net上不同inst坐标的平均值，与FlatNetlist::getNetCenter相同
+    std::pair<int, int> getNetCenter(int netIdx);
+    // inst的位置改变之后调用
+    void instMoved(Instance *inst);
+
+private:
+    const FlatNetlist *flat = nullptr;
+    bool isBaseline = false;
+
+    std::vector<int> movableStart; // CSR，net下标 -> 非固定pin的inst下标
+    std::vector<int> movableInsts;
+
+    std::vector<std::pair<int, int>> centers;
+    std::vector<char> centerValid;
+};
+
+extern MoveGenerator glbMoveGen;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include "object.h"
+
+/*
+SA试探移动的修改日志
+1、试探移动对inst坐标、tile slot、跨tile连接计数的修改都经过journal，同时记下撤销需要的旧值
+2、接受移动commit只清空日志；拒绝移动rollback按相反顺序撤销，只处理这次改过的内容
+3、slot中删除的inst记录原来的位置，撤销时插回原位，slot内的顺序与移动前完全相同
+线长的试探值由Net的pendingWL暂存（evalRelatedWirelength/commitRelatedWirelength），不经过journal
+*/
+class MoveJournal
+{
+public:
+    void begin(bool isBaseline)
+    {
+        this->isBaseline = isBaseline;
+        entries.clear();
+    }
+    // 修改inst坐标
+    void setLocation(Instance *inst, const std::tuple<int, int, int> &loc);
+    // 与changeTile相同的slot修改（配对的LUT一起移动），并更新跨tile连接计数与空闲位置索引
+    void changeTile(Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc);
+
+    void commit() { entries.clear(); }
+    void rollback();
+
+private:
+    enum EntryType
+    {
+        ENTRY_LOCATION,    // inst坐标，loc为旧值
+        ENTRY_SLOT_ADD,    // tile的offset slot末尾加入了instID
+        ENTRY_SLOT_REMOVE, // 从tile的offset slot第pos个删除了instID
+        ENTRY_TILE_PIN     // inst的跨tile连接从loc移到了loc2
+    };
+    struct Entry
+    {
+        EntryType type;
+        Instance *inst; // 坐标与连接计数对应的inst，slot修改时为决定slot类型的inst
+        Tile *tile;
+        int instID;
+        int offset;
+        int pos;
+        std::tuple<int, int, int> loc;
+        std::tuple<int, int, int> loc2;
+    };
+
+    bool isBaseline = false;
+    std::vector<Entry> entries;
+
+    void addInstance(Tile *tile, Instance *typeInst, int instID, int offset);
+    void removeInstance(Tile *tile, Instance *typeInst, int instID, int offset);
+    void moveTilePin(Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <unordered_map>
+#include "object.h"
+
+// net的外包矩形，同时记录落在每条边上的pin数（VPR的增量bounding box）
+struct NetBBox
+{
+    int xMin, xMax, yMin, yMax;
+    int xMinCnt, xMaxCnt, yMinCnt, yMaxCnt;
+
+    int getHPWL() const { return xMax - xMin + yMax - yMin; }
+};
+
+/*
+HPWL模式的增量外包矩形
+1、build时扫描一次所有net，并按instID以CSR形式记录每个inst相关的(net下标, pin数)
+2、evalMove在inst位置修改之后调用，只更新与该inst相关的net，每个pin O(1)；只有边上的最后一批pin离开边时才重新扫描该net
+3、多个inst（配对的LUT）在同一net上的pin数用按epoch标记的net数组合并，pending等数组重复使用，evalMove不分配内存
+4、结果先放在pending里，接受移动时commitMove，拒绝时不用处理（下一次evalMove会清空pending）
+clock net不计入，与getHPWL一致
+*/
+class NetBBoxEngine
+{
+public:
+    void build(std::map<int, Net *> &netMap, bool isBaseline);
+
+    int getTotalHPWL() const { return totalHPWL; }
+    int getNetHPWL(int netId) const;
+
+    // 返回移动引起的HPWL变化量，movedInsts[0..numInsts)共享同一个起点与终点（例如配对的LUT）
+    int evalMove(const Instance *const *movedInsts, int numInsts, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc);
+    void commitMove();
+
+private:
+    bool isBaseline = false;
+    int totalHPWL = 0;
+    std::vector<Net *> nets;
+    std::vector<NetBBox> boxes;
+    std::unordered_map<int, int> netIndex; // netId -> 下标
+
+    // instID -> instPinStart[id]..instPinStart[id+1]，net下标与该inst在net上的pin数
+    std::vector<int> instPinStart;
+    std::vector<int> instPinNet;
+    std::vector<int> instPinCount;
+
+    // 按net下标，netMark等于epoch时netSlot为该net在pending中的位置
+    std::vector<unsigned> netMark;
+    std::vector<int> netSlot;
+    unsigned epoch = 0;
+
+    std::vector<std::pair<int, NetBBox>> pending;
+    std::vector<int> pendingPins; // pending中每个net移动的pin数
+    int pendingDelta = 0;
+
+    void scanNet(Net *net, NetBBox &box) const;
+    bool updateAxis(int &vMin, int &vMax, int &minCnt, int &maxCnt, int vOld, int vNew, int k) const;
+};
+
+extern NetBBoxEngine glbNetBBox;
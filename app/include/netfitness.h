@@ -0,0 +1,56 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include "netlistcsr.h"
+
+/*
+SA中选net用的fitness优先级结构，按FlatNetlist的net下标存放
+1、range为net外包矩形的平均跨度（半周线长的一半），desired为上次提升时的actual
+2、fitness = actual与desired的比值（取小比大），越小越需要移动
+3、order按fitness分桶有序，posOf为net下标到位置的索引，更新一个net只在相邻桶的边界交换，不需要整体排序
+4、采样取两个均匀随机位置中靠前的一个，偏向fitness小的net
+5、desired按epoch写时复制，promote只把epoch加一，不复制整个数组
+6、可以只对部分net建立（多线程时每个线程一份），不在其中的net不参与采样，updateNet直接忽略
+*/
+class NetFitness
+{
+public:
+    void build(const FlatNetlist &flat, bool isBaseline) { build(flat, glbPlacementState[isBaseline]); }
+    // range按state中的坐标计算，state需要在使用期间一直有效
+    void build(const FlatNetlist &flat, const PlacementState &state);
+    // 只包含nets中的net下标
+    void build(const FlatNetlist &flat, const PlacementState &state, const std::vector<int> &nets);
+    void clear();
+
+    int getNumNets() const { return order.size(); }
+    int sampleNet(std::mt19937 &rng) const;
+    int getDesiredRange(int netIdx) const { return desiredEpoch[netIdx] == epoch ? desired[netIdx] : actual[netIdx]; }
+    float getFitness(int netIdx) const { return fitness[netIdx]; }
+
+    // 按当前坐标重新计算actual range与fitness
+    void updateNet(int netIdx);
+    // 所有net的desired = actual
+    void promoteActual() { epoch++; }
+
+private:
+    static const int NUM_BUCKETS = 64;
+
+    static float calculFitness(int rangeDesired, int rangeActual);
+    static int bucketOf(float fitness);
+    void moveToBucket(int netIdx, int bucket);
+
+    const FlatNetlist *flat = nullptr;
+    const PlacementState *state = nullptr;
+
+    std::vector<int> actual;
+    std::vector<int> desired;
+    std::vector<unsigned> desiredEpoch;
+    unsigned epoch = 0;
+
+    std::vector<float> fitness;
+    std::vector<int> bucket;
+    std::vector<int> order;
+    std::vector<int> posOf;
+    std::vector<int> bucketStart; // NUM_BUCKETS + 1
+};
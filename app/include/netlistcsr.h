@@ -0,0 +1,87 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include "object.h"
+
+/*
+只读的扁平netlist（CSR），在SA开始时由netMap构建一次
+1、net按下标连续存放，netPinStart[i]..netPinStart[i+1]为net i的pin，有driver时第一个pin是driver
+2、pin只存inst下标、instID、关键路径标记与pin属性，坐标按instID从PlacementState读取
+3、instIndex按instID直接索引，instNetStart/instNets为每个inst相关的net下标（去重），netInstStart/netInstIds为每个net上的instID（去重）
+pin的连接关系在构建后不能再修改，打包或重新读入之后需要重新build
+*/
+class FlatNetlist
+{
+public:
+    void build(std::map<int, Net *> &netMap);
+    bool isBuilt(const std::map<int, Net *> &netMap) const { return built && source == &netMap; }
+    void clear();
+
+    int getNumNets() const { return netIds.size(); }
+    int getNetIndex(int netId) const { return netId >= 0 && netId < (int)netIndex.size() ? netIndex[netId] : -1; }
+    int getNetId(int idx) const { return netIds[idx]; }
+    Net *getNet(int idx) const { return netPtrs[idx]; }
+    bool isClock(int idx) const { return netClock[idx]; }
+    bool hasDriver(int idx) const { return netDriver[idx]; }
+    int getNumPins(int idx) const { return netPinStart[idx + 1] - netPinStart[idx]; }
+
+    int getNumInsts() const { return insts.size(); }
+    int getInstIndex(const Instance *inst) const
+    {
+        int id = inst->getInstID();
+        return id >= 0 && id < (int)instIndex.size() ? instIndex[id] : -1;
+    }
+    Instance *getInst(int instIdx) const { return insts[instIdx]; }
+    const int *getInstNetsBegin(int instIdx) const { return instNets.data() + instNetStart[instIdx]; }
+    const int *getInstNetsEnd(int instIdx) const { return instNets.data() + instNetStart[instIdx + 1]; }
+
+    // net上各pin的inst下标，有driver时第一个是driver
+    const int *getPinInstsBegin(int idx) const { return pinInst.data() + netPinStart[idx]; }
+    const int *getPinInstsEnd(int idx) const { return pinInst.data() + netPinStart[idx + 1]; }
+
+    // 按指针查找net下标，不属于该netlist时返回-1
+    int findNet(Net *net) const;
+
+    // 与Net::getCritWireLength + Net::getNonCritWireLength一致
+    int getNetWireLength(int idx, bool isBaseline) const { return getNetWireLength(idx, glbPlacementState[isBaseline]); }
+    // 所有pin的外包矩形半周长
+    int getNetHPWL(int idx, bool isBaseline) const { return getNetHPWL(idx, glbPlacementState[isBaseline]); }
+    // net上不同inst坐标的平均值
+    std::pair<int, int> getNetCenter(int idx, bool isBaseline) const { return getNetCenter(idx, glbPlacementState[isBaseline]); }
+
+    // 按给定的坐标计算，用于不写回Instance的布局副本；视图每个net只选择一次，pin循环内没有分支
+    int getNetWireLength(int idx, const PlacementState &state) const;
+    int getNetHPWL(int idx, const PlacementState &state) const;
+    std::pair<int, int> getNetCenter(int idx, const PlacementState &state) const;
+
+private:
+    bool built = false;
+    const std::map<int, Net *> *source = nullptr;
+
+    std::vector<int> netIds;
+    std::vector<Net *> netPtrs;
+    std::vector<int> netIndex; // netId -> 下标，-1表示不存在
+    std::vector<char> netClock;
+    std::vector<char> netDriver;
+    std::vector<int> netPinStart;
+
+    std::vector<int> pinInst;
+    std::vector<int> pinInstId;
+    std::vector<char> pinCrit;
+    std::vector<char> pinProp;
+
+    std::vector<Instance *> insts;
+    std::vector<int> instIndex; // instID -> inst下标，-1表示不存在
+    std::vector<int> instNetStart;
+    std::vector<int> instNets;
+    std::vector<int> netInstStart;
+    std::vector<int> netInstIds;
+
+};
+
+extern FlatNetlist glbFlatNetlist;     // glbNetMap
+extern FlatNetlist glbFlatPackNetlist; // glbPackNetMap
+
+// 返回为该netMap构建好的FlatNetlist，没有则返回nullptr
+const FlatNetlist *getFlatNetlist(const std::map<int, Net *> &netMap);
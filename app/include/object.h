@@ -8,6 +8,7 @@
 #include <set>    // 包含对 std::set 的支持
 #include <limits>
 #include <algorithm>
+#include "placement.h"
 
 // PLB slots
 #define MAX_LUT_CAPACITY 8
@@ -45,14 +46,99 @@ enum PinProp
 class Instance;
 class Net;
 class SEQBankPlacement;
+// slot中的inst列表，最多2个（LUT对）时存放在内部数组中，不分配内存
+// 超过2个（非法布局）时才转移到vector
+class SlotInstances
+{
+private:
+    static const int INLINE_CAPACITY = 2;
+    int inlineArr[INLINE_CAPACITY];
+    std::vector<int> overflowArr;
+    int count = 0;
+    bool onHeap = false;
+
+public:
+    typedef const int *const_iterator;
+    typedef int *iterator;
+
+    int *data() { return onHeap ? overflowArr.data() : inlineArr; }
+    const int *data() const { return onHeap ? overflowArr.data() : inlineArr; }
+    iterator begin() { return data(); }
+    iterator end() { return data() + count; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + count; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int front() const { return data()[0]; }
+    int operator[](int idx) const { return data()[idx]; }
+
+    void push_back(int instID)
+    {
+        if (!onHeap && count < INLINE_CAPACITY)
+        {
+            inlineArr[count++] = instID;
+            return;
+        }
+        if (!onHeap)
+        {
+            overflowArr.assign(inlineArr, inlineArr + count);
+            onHeap = true;
+        }
+        overflowArr.push_back(instID);
+        count++;
+    }
+    // 在idx处插入，保持其余inst的顺序
+    void insert(int idx, int instID)
+    {
+        push_back(instID);
+        int *arr = data();
+        for (int i = count - 1; i > idx; i--)
+            arr[i] = arr[i - 1];
+        arr[idx] = instID;
+    }
+    // 删除pos处的inst，保持其余inst的顺序
+    iterator erase(iterator pos)
+    {
+        int idx = pos - begin();
+        if (onHeap)
+        {
+            overflowArr.erase(overflowArr.begin() + idx);
+        }
+        else
+        {
+            for (int i = idx; i + 1 < count; i++)
+                inlineArr[i] = inlineArr[i + 1];
+        }
+        count--;
+        return begin() + idx;
+    }
+    void remove(int instID)
+    {
+        for (iterator it = begin(); it != end();)
+        {
+            if (*it == instID)
+                it = erase(it);
+            else
+                ++it;
+        }
+    }
+    void clear()
+    {
+        count = 0;
+        onHeap = false;
+        overflowArr.clear();
+    }
+};
+
 class Slot
 {
 private:
     // normally each slot is holding 1 instance
     // the exception is the LUT slot can hold up to 2 LUTs
     // with shared inputs
-    std::list<int> optimizedInstArr; // container of the optimized design instances
-    std::list<int> baselineInstArr;  // container of the input design instances
+    SlotInstances optimizedInstArr; // container of the optimized design instances
+    SlotInstances baselineInstArr;  // container of the input design instances
 public:
     // Constructor
     Slot() {}
@@ -69,15 +155,106 @@ public:
     void clearOptimizedInstances() { optimizedInstArr.clear(); }
 
     void addOptimizedInstance(int instID) { optimizedInstArr.push_back(instID); }
-    std::list<int> getOptimizedInstances() const { return optimizedInstArr; }
+    const SlotInstances &getOptimizedInstances() const { return optimizedInstArr; }
 
     void addBaselineInstance(int instID) { baselineInstArr.push_back(instID); }
-    std::list<int> &getBaselineInstances() { return baselineInstArr; }
-    std::list<int> &getOptimizedInstancesRef() { return optimizedInstArr; }
+    const SlotInstances &getBaselineInstances() const { return baselineInstArr; }
+    const SlotInstances &getInstances(bool isBaseline) const { return isBaseline ? baselineInstArr : optimizedInstArr; }
+
+    // 可修改的引用
+    SlotInstances &getBaselineInstancesRef() { return baselineInstArr; }
+    SlotInstances &getOptimizedInstancesRef() { return optimizedInstArr; }
+    SlotInstances &getInstancesRef(bool isBaseline) { return isBaseline ? baselineInstArr : optimizedInstArr; }
 };
 
 typedef std::vector<Slot *> slotArr;
 
+// 小容量的net引用计数表，slot/bank内的net很少，线性查找即可，不分配内存
+template <int N>
+struct NetRefTable
+{
+    int netId[N];
+    int ref[N];
+    int n = 0;
+    bool overflow = false; // 超出容量（布局本身已经非法），按不可再放处理
+
+    void clear()
+    {
+        n = 0;
+        overflow = false;
+    }
+    bool contains(int id) const
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (netId[i] == id)
+                return true;
+        }
+        return false;
+    }
+    void add(int id)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (netId[i] == id)
+            {
+                ref[i]++;
+                return;
+            }
+        }
+        if (n == N)
+        {
+            overflow = true;
+            return;
+        }
+        netId[n] = id;
+        ref[n] = 1;
+        n++;
+    }
+    void remove(int id)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (netId[i] == id)
+            {
+                if (--ref[i] == 0)
+                {
+                    n--;
+                    netId[i] = netId[n];
+                    ref[i] = ref[n];
+                }
+                return;
+            }
+        }
+    }
+    int size() const { return overflow ? N + 1 : n; }
+};
+
+#define MAX_OCC_LUT_NETS 12
+#define MAX_OCC_CTRL_NETS 8
+
+// PLB tile的占用状态，由Tile::addInstance/removeInstanceAt/clear*维护，isValid/isPackValid直接用位运算判断
+struct TileOccupancy
+{
+    unsigned char lutUsed;   // bit i: LUT slot i 非空
+    unsigned char lutPacked; // bit i: LUT slot i 里是打包好的LUT对
+    unsigned char dramUsed;
+    unsigned char carryUsed;
+    unsigned short seqUsed; // bit 0-7 bank0, bit 8-15 bank1
+    unsigned char lutCount[MAX_LUT_CAPACITY];
+    unsigned char seqCount[MAX_DFF_CAPACITY];
+    unsigned char dramCount[MAX_DRAM_CAPACITY];
+    unsigned char carryCount[MAX_CARRY4_CAPACITY];
+    NetRefTable<MAX_OCC_LUT_NETS> lutInputNets[MAX_LUT_CAPACITY]; // 每个LUT slot的输入net并集
+    NetRefTable<MAX_OCC_CTRL_NETS> clkNets[2];                   // 每个bank的控制集
+    NetRefTable<MAX_OCC_CTRL_NETS> ceNets[2];
+    NetRefTable<MAX_OCC_CTRL_NETS> srNets[2];
+};
+
+void occupancyClear(TileOccupancy &occ);
+void occupancyAdd(TileOccupancy &occ, const std::string &slotType, int offset, Instance *inst);
+void occupancyRemove(TileOccupancy &occ, const std::string &slotType, int offset, Instance *inst);
+
 struct LUTUsage
 {
     int numInstances;            // 已用的LUT实例数量
@@ -99,9 +276,15 @@ private:
     std::vector<LUTUsage> lutUsage;
     int dffUsage; // 剩余的DFF资源
 
+    TileOccupancy occupancy[2]; // 下标 0 为optimized，1 为baseline
+
 public:
     // Constructor
-    Tile(int c, int r) : col(c), row(r), lutUsage(MAX_LUT_CAPACITY) {} // 初始化lutUsage为全2——吴白轩
+    Tile(int c, int r) : col(c), row(r), lutUsage(MAX_LUT_CAPACITY) // 初始化lutUsage为全2——吴白轩
+    {
+        occupancyClear(occupancy[0]);
+        occupancyClear(occupancy[1]);
+    }
     // Tile(int c, int r) : col(c), row(r) {}
 
     // Destructor
@@ -125,6 +308,11 @@ public:
 
     bool isEmpty(bool isBaseline);
     bool addInstance(int instID, int offset, std::string modelType, const bool isBaseline);
+    bool removeInstanceAt(int instID, int offset, std::string modelType, const bool isBaseline); // 从指定slot中移除
+    bool insertInstanceAt(int instID, int offset, int pos, std::string modelType, const bool isBaseline); // 插入到slot中的第pos个，用于撤销removeInstanceAt
+    void clearSlot(int offset, std::string modelType, const bool isBaseline);
+    const TileOccupancy &getOccupancy(bool isBaseline) const { return occupancy[isBaseline]; }
+    void rebuildOccupancy(); // 直接修改slot之后，或者inst的pin变化之后（打包）需要重建
     void clearInstances();
     void clearBaselineInstances();
     void clearOptimizedInstances();
@@ -330,10 +518,18 @@ public:
 
     // Getter and setter
     std::tuple<int, int, int> getBaseLocation() const { return baseLocation; }
-    void setBaseLocation(const std::tuple<int, int, int> &loc) { baseLocation = loc; }
+    void setBaseLocation(const std::tuple<int, int, int> &loc)
+    {
+        baseLocation = loc;
+        glbPlacementState[1].set(instID, loc);
+    }
 
     std::tuple<int, int, int> getLocation() const { return location; }
-    void setLocation(const std::tuple<int, int, int> &loc) { location = loc; }
+    void setLocation(const std::tuple<int, int, int> &loc)
+    {
+        location = loc;
+        glbPlacementState[0].set(instID, loc);
+    }
 
     bool isFixed() const { return fixed; }
     void setFixed(bool value) { fixed = value; }
@@ -387,16 +583,22 @@ public:
 
     void setSEQID(int _seqID) { seqGroupID = _seqID; }
     int getSEQID() { return seqGroupID; }
-    int getInstID()
+    int getInstID() const
     {
         // size_t underscorePos = instanceName.find('_');                                                        // 找到下划线的位置
         // return (underscorePos != std::string::npos) ? std::stoi(instanceName.substr(underscorePos + 1)) : -1; // 提取并转换
         return instID;
     }
-    void setInstID(int _instID) { instID = _instID; }
+    void setInstID(int _instID)
+    {
+        instID = _instID;
+        glbPlacementState[1].set(instID, baseLocation);
+        glbPlacementState[0].set(instID, location);
+    }
 
     void addMapInstID(int _id) { instMapIDVec.push_back(_id); }
     std::vector<int> getMapInstID() { return instMapIDVec; }
+    int getNumMapInstID() const { return instMapIDVec.size(); }
 
     void unionInputPins(const std::vector<Pin *> &vec1);
     void unionOutputPins(const std::vector<Pin *> &vec1);
@@ -416,11 +618,17 @@ class Net
     std::vector<int> netArea; // net 的最小外包矩形
     int originID;             // 原始的netID，用于找instance的pin的新的netID
 
+    // 线长缓存（crit + nonCrit），下标 0 为optimized，1 为baseline
+    int cachedWL[2];
+    bool cachedWLValid[2];
+    int pendingWL[2]; // 移动后试算的线长，接受移动后写入缓存
+
 public:
     Net(int netID) : id(netID), clock(false), inpin(nullptr)
     {
         netArea.assign(4, -1); //(xlb,ylb,xrt,yrt)
         originID = -1;
+        invalidateWireLength();
     } // 默认构造函数
     ~Net() {} // 析构函数
 
@@ -460,6 +668,23 @@ public:
     int getNonCritWireLength(bool isBaseline);
     int getNonCritHPWL(bool isBaseline); // cjq 增加半周线长的计算方式
 
+    // 带缓存的线长，pin位置变化后需要 evalWireLength + commitWireLength 或 invalidateWireLength
+    int getCachedWireLength(bool isBaseline);
+    int evalWireLength(bool isBaseline);
+    bool isWireLengthCached(bool isBaseline) const { return cachedWLValid[isBaseline]; }
+    void setPendingWireLength(bool isBaseline, int wirelength) { pendingWL[isBaseline] = wirelength; }
+    void commitWireLength(bool isBaseline)
+    {
+        cachedWL[isBaseline] = pendingWL[isBaseline];
+        cachedWLValid[isBaseline] = true;
+    }
+    void invalidateWireLength()
+    {
+        cachedWLValid[0] = cachedWLValid[1] = false;
+        cachedWL[0] = cachedWL[1] = 0;
+        pendingWL[0] = pendingWL[1] = 0;
+    }
+
     std::vector<int> getBoundingBox() { return netArea; } // 获取最小外包矩形信息
 
     // report util
@@ -1,7 +1,40 @@
 #pragma once
 
+#include <set>
+#include <unordered_map>
+#include <vector>
+
 bool reportPinDensity();
 
 void setPinDensityMapAndTopValues();
 
 int getPinDensityByXY(int x, int y); //根据x y 获取pin密度分子
+
+/*
+pin密度top-K和的增量维护
+top存最大的K个值，rest存其余的值，始终保持 max(rest) <= min(top)
+修改一个tile的分子为O(log n)，top-K之和直接读取
+不在表中的tile分子视为0
+*/
+class PinDensityTracker
+{
+public:
+    void build(const std::vector<std::pair<int, int>> &values, int topK);
+    void clear();
+
+    int get(int loc) const;
+    void set(int loc, int value);
+    int getTopSum() const { return topSum; }
+    int getTopK() const { return topK; }
+
+private:
+    int topK = 0;
+    int topSum = 0;
+    std::multiset<int> top;
+    std::multiset<int> rest;
+    std::unordered_map<int, int> valueMap; // loc -> 分子
+
+    void insertValue(int value);
+    void eraseValue(int value);
+    void rebalance();
+};
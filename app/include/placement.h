@@ -0,0 +1,43 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+
+/*
+按instID连续存放的坐标，每种视图一份（下标为isBaseline）
+Instance的setLocation/setBaseLocation/setInstID会同步写入，热点函数直接按instID读取数组
+*/
+struct PlacementState
+{
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> z;
+
+    int size() const { return x.size(); }
+    void set(int instID, const std::tuple<int, int, int> &loc)
+    {
+        if (instID < 0)
+        {
+            return;
+        }
+        if (instID >= size())
+        {
+            x.resize(instID + 1, -1);
+            y.resize(instID + 1, -1);
+            z.resize(instID + 1, -1);
+        }
+        x[instID] = std::get<0>(loc);
+        y[instID] = std::get<1>(loc);
+        z[instID] = std::get<2>(loc);
+    }
+};
+
+extern PlacementState glbPlacementState[2];
+
+// (x,y)打包成一个整数，按无符号整数排序与按(x,y)字典序一致，用于坐标去重
+inline unsigned long long packXY(int x, int y)
+{
+    return ((unsigned long long)((unsigned)x ^ 0x80000000u) << 32) | ((unsigned)y ^ 0x80000000u);
+}
+inline int unpackX(unsigned long long key) { return (int)((unsigned)(key >> 32) ^ 0x80000000u); }
+inline int unpackY(unsigned long long key) { return (int)((unsigned)key ^ 0x80000000u); }
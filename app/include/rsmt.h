@@ -50,8 +50,10 @@
 
 #define FLUTE_POWVFILE "WorkSpace/public/FLUTE_LIB/POWV9.dat"  // LUT for POWV (Wirelength Vector)
 #define FLUTE_POSTFILE "WorkSpace/public/FLUTE_LIB/POST9.dat"  // LUT for POST (Steiner Tree)
+#define FLUTE_LUTIMAGE "flute9.lut"  // 由flute_lut_convert生成的二进制查找表，放在可执行文件旁边
 
 #define FLUTE_D 9                   // LUT is used for d <= FLUTE_D, FLUTE_D <= 9
+#define HD_APPROX_D 128             // 开启近似模型时，引脚数超过该值的net不建FLUTE树（setHighDegreeModel），与bigNet的引脚数阈值分开调
 
 // Use flute LUT file reader.
 #define LUT_FILE 1
@@ -60,12 +62,23 @@
 // Init LUTs from base64 encoded string variables
 // and check against LUTs from file reader.
 #define LUT_VAR_CHECK 3
+// 二进制查找表镜像：编译时嵌入(FLUTE_EMBED_LUT) > flute9.lut > 文本文件
+#define LUT_BIN 4
 
-// Set this to LUT_FILE, LUT_VAR, or LUT_VAR_CHECK.
-#define LUT_SOURCE LUT_FILE
+// Set this to LUT_FILE, LUT_VAR, LUT_VAR_CHECK or LUT_BIN.
+#define LUT_SOURCE LUT_BIN
+//#define LUT_SOURCE LUT_FILE
 //#define LUT_SOURCE LUT_VAR
 //#define LUT_SOURCE LUT_VAR_CHECK
 
+#ifdef FLUTE_EMBED_LUT
+// 由flute_lut_convert --cpp生成
+extern const unsigned char fluteLutImage[];
+extern const unsigned long fluteLutImageSize;
+#endif
+
+class MappedFile;
+
 typedef int DTYPE;
 
 struct Branch{
@@ -102,6 +115,32 @@ struct csoln {
   unsigned char neighbor[2 * FLUTE_D - 2];
 };
 
+// 排序与求线长用到的工作区，按需增长后复用，调用之间不再malloc
+struct FluteScratch {
+  std::vector<DTYPE> xs;
+  std::vector<DTYPE> ys;
+  std::vector<int> s;
+  std::vector<point> pt;
+  std::vector<point*> ptp;
+  // rmstWireLength用
+  std::vector<DTYPE> px;
+  std::vector<DTYPE> py;
+  std::vector<int> order;
+  std::vector<DTYPE> keys;    // 离散化的y-x
+  std::vector<DTYPE> bitVal;  // 树状数组，前缀中最小的x+y
+  std::vector<int> bitIdx;
+  std::vector<int> parent;
+  std::vector<std::pair<DTYPE, std::pair<int, int>>> edges;
+
+  void reserve(int d);
+};
+
+// 高度数net的线长模型，引脚数超过阈值时才生效，阈值以下始终是FLUTE
+enum HighDegreeModel {
+  HD_FLUTE = 0,  // 完整FLUTE建树，精确但慢
+  HD_RMST = 1,   // 直角最小生成树，O(d log d)，RSMT <= RMST <= 1.5 * RSMT
+};
+
 typedef struct csoln ***LUT_TYPE;
 typedef int **NUMSOLN_TYPE;
 // struct csoln *LUT[FLUTE_D + 1][MGROUP];  // storing 4 .. FLUTE_D
@@ -127,6 +166,8 @@ class RecSteinerMinTree {
   std::list<std::string> vectorArr_;
 
   int accuracy_;    // acc =3 by default
+  HighDegreeModel hdModel_;  // HD_FLUTE by default
+  int hdThreshold_;
 
   int lutInitialDegree_;
   int lutValidDegree_;
@@ -135,11 +176,17 @@ class RecSteinerMinTree {
   NUMSOLN_TYPE numSoln_; // numsoln[FLUTE_D + 1][MGROUP];
   
    std::list<struct csoln *> memTracker_;   // to avoid double free of 
+   MappedFile *lutImage_;   // mmap的二进制查找表，SteinerLut_直接指向其中
 
  public:
   RecSteinerMinTree();
+  explicit RecSteinerMinTree(bool loadLUT);  // loadLUT为false时不读查找表，供转换工具使用
   ~RecSteinerMinTree();
 
+  // 二进制查找表
+  bool loadLUTText(const std::string& powvFile, const std::string& postFile);
+  bool writeLUTImage(std::string& image) const;
+
   // member access
   std::list<std::string>& treeArr(void) { return treeArr_; }
   std::list<std::string>& vectorArr(void) { return vectorArr_; }
@@ -152,6 +199,15 @@ class RecSteinerMinTree {
 
   DTYPE fltWireLength(std::vector<DTYPE>& x, std::vector<DTYPE>& y);
   Tree fltTree(std::vector<DTYPE>& x, std::vector<DTYPE>& y);
+  // 与wirelength(fltTree(x, y))结果相同，但d <= FLUTE_D时不建树，直接取查找表中的最短解
+  // 查找表读入完整后(LUT_FILE/LUT_BIN)只读查找表，使用调用者或线程自己的工作区，可在多个线程中同时调用
+  DTYPE treeWireLength(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch);
+  DTYPE treeWireLength(const DTYPE* x, const DTYPE* y, int d);  // 使用thread_local工作区
+  // 引脚数 > threshold 的net改用model估计，不要在其他线程求线长时切换
+  void setHighDegreeModel(HighDegreeModel model, int threshold);
+  HighDegreeModel highDegreeModel() const { return hdModel_; }
+  bool isExact(int d) const { return hdModel_ == HD_FLUTE || d <= hdThreshold_; }
+  static DTYPE rmstWireLength(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch);
   DTYPE wirelength(Tree t);
   void printtree(Tree t);
   void plottree(Tree t);
@@ -166,7 +222,9 @@ private:
   unsigned char charNum(unsigned char c);
   bool is_base64(unsigned char c);
   std::string base64_decode(std::string const& encoded_string);
-  void readLUTfiles();
+  bool readLUTfiles(const std::string& powvFile, const std::string& postFile);
+  bool loadLUTImage(const unsigned char* data, size_t size);
+  bool loadLUTImageFile(const std::string& fileName);
   void makeLUT(LUT_TYPE &LUT, NUMSOLN_TYPE &numsoln);
   void deleteLUT(LUT_TYPE &LUT, NUMSOLN_TYPE &numsoln);
   void initLUT(int to_d, LUT_TYPE LUT, NUMSOLN_TYPE numsoln);
@@ -183,6 +241,8 @@ private:
 // util.
   static int orderx(const void *a, const void *b);
   static int ordery(const void *a, const void *b);
+  // 按fltTree的方式排序得到xs/ys/s
+  static void sortPins(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch);
 
 // Other useful functions
   DTYPE flutes_wl(int d, DTYPE xs[], DTYPE ys[], int s[], int acc);
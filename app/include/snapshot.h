@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+设计快照，调参时同一个case反复运行，跳过文本解析
+1、第一次读入lib/scl/clk/nodes/nets/timing之后saveSnapshot，保存lib、tile网格、时钟区域、inst、net连接与时序关键pin
+2、之后的运行mmap快照，直接重建glbLibMap/chip/glbInstMap/glbNetMap
+3、快照头部记录格式版本与每个输入文件内容的FNV-1a hash，版本或任一输入变化时loadSnapshot返回false，重新读文本
+快照按本机字节序存放，只用于本机缓存
+*/
+bool loadSnapshot(const std::string &snapFile, const std::vector<std::string> &inputFiles);
+bool saveSnapshot(const std::string &snapFile, const std::vector<std::string> &inputFiles);
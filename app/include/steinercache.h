@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/*
+FLUTE线长缓存，SA中同样形状的小net反复出现
+1、key为平移到原点后的pin坐标序列（保持调用者的顺序），调用者传入按(x, y)升序去重的坐标，相同形状得到相同key
+2、FLUTE的结果只与坐标差有关，命中时直接返回之前的结果，不改变线长
+3、按hash分成多个shard，每个shard一把锁和固定数量的直接映射槽位，冲突时覆盖旧项，内存有上限
+只缓存3 <= d <= MAX_DEGREE的net，2个pin直接计算
+*/
+class SteinerCache
+{
+public:
+    static const int MAX_DEGREE = 16;
+
+    explicit SteinerCache(int numEntries = 1 << 16);
+
+    // 与rsmt.treeWireLength(x, y, d)相同
+    int getWireLength(const int *x, const int *y, int d);
+
+    void clear();
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    void report() const;
+
+private:
+    static const int NUM_SHARDS = 64;
+
+    struct Entry
+    {
+        uint64_t hash = 0; // 0表示空
+        int d = 0;
+        int length = 0;
+        uint16_t coords[2 * MAX_DEGREE];
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mtx;
+        std::vector<Entry> entries;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    int slotsPerShard;
+    Shard shards[NUM_SHARDS];
+};
+
+extern SteinerCache glbSteinerCache;
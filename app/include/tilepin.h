@@ -0,0 +1,55 @@
+#pragma once
+
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "object.h"
+
+/*
+PLB tile的跨tile连接数（pin密度的分子），与Tile::getConnectedLutSeqInput/Output的定义一致
+input：tile内LUT/SEQ输入pin所连的net，且driver不在该tile
+output：tile内LUT/SEQ驱动的net，且有sink不在该tile
+每个net记录driver所在tile和各tile的sink pin数，inst移动时只增量修改它的pin所在的net
+*/
+class TilePinCounter
+{
+public:
+    void build(bool isBaseline);
+    bool isBuilt(bool isBaseline) const { return built && this->isBaseline == isBaseline; }
+    void clear();
+
+    // inst的位置修改之后调用，没有按该视图build时不处理
+    void moveInstance(bool isBaseline, Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc);
+
+    int getInputCount(int x, int y) const { return tileInput[x * numRow + y]; }
+    int getOutputCount(int x, int y) const { return tileOutput[x * numRow + y]; }
+    int getPinCount(int x, int y) const { return getInputCount(x, y) + getOutputCount(x, y); }
+
+private:
+    struct NetTileCount
+    {
+        int driverTile = -1;
+        bool driverLutSeq = false;
+        int numSinks = 0;
+        std::unordered_map<int, int> sinkCount;       // tile -> sink pin数
+        std::unordered_map<int, int> lutSeqSinkCount; // tile -> LUT/SEQ的sink pin数
+
+        bool isInterTile() const;
+    };
+
+    bool built = false;
+    bool isBaseline = true;
+    int numRow = 0;
+    std::unordered_map<int, NetTileCount> nets;
+    std::vector<int> tileInput;
+    std::vector<int> tileOutput;
+
+    int getTileIndex(const std::tuple<int, int, int> &loc) const { return std::get<0>(loc) * numRow + std::get<1>(loc); }
+    void addSink(NetTileCount &net, int tile, bool isLutSeq);
+    void removeOutput(const NetTileCount &net);
+    void addOutput(const NetTileCount &net);
+    void moveSink(NetTileCount &net, int fromTile, int toTile, bool isLutSeq);
+    void moveDriver(NetTileCount &net, int fromTile, int toTile);
+};
+
+extern TilePinCounter glbTilePinCounter;
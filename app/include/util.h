@@ -1,5 +1,39 @@
-
 #pragma once
 
+#include <string>
+#include <cstddef>
+
 // unitfy lut1-6 as lut
-std::string unifyModelType(std::string inputType);
\ No newline at end of file
+std::string unifyModelType(std::string inputType);
+
+// 只读方式映射整个文件，析构时解除映射
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    bool isOpen() const { return opened; }
+    const char *begin() const { return data; }
+    const char *end() const { return data + length; }
+    size_t size() const { return length; }
+
+private:
+    bool opened = false;
+    const char *data = nullptr;
+    size_t length = 0;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+// 取下一行，[lineBegin, lineEnd)不含换行符，文件结束返回false
+bool nextLine(const char *&cur, const char *end, const char *&lineBegin, const char *&lineEnd);
+// 取下一个以空白分隔的token，没有则返回false
+bool nextToken(const char *&cur, const char *end, const char *&tokBegin, const char *&tokEnd);
+// 解析开头的整数（可带负号），与std::stoi一样忽略后面的字符
+bool parseInt(const char *begin, const char *end, int &value);
+// 查找"X<数字>Y<数字>Z<数字>"，与正则X(\d+)Y(\d+)Z(\d+)的search一致
+bool parseLocationXYZ(const char *begin, const char *end, int &x, int &y, int &z);
+// 解析名字中第一个'_'之后的编号，如 inst_12 / net_3
+bool parseIDAfterUnderscore(const char *begin, const char *end, int &id);
@@ -10,4 +10,21 @@ int getHPWL(bool isBaseline);
 
 int getPackWirelength(bool isBaseline);
 
-int getPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
\ No newline at end of file
+int getPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+
+// 带缓存的相关线长
+int getCachedRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+int evalRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+void commitRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+
+int getCachedPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+int evalPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+void commitPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId);
+
+// 按FlatNetlist的net下标[netsBegin, netsEnd)，不查找netMap也不分配内存；多线程时由调用方对net加锁
+class FlatNetlist;
+int getCachedFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd);
+int evalFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd);
+void commitFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd);
+
+void invalidateWirelengthCache(std::map<int, Net*>& netMap);
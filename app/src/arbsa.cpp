@@ -8,6 +8,15 @@
 #include "wirelength.h"
 #include <random>
 #include "pindensity.h"
+#include "netbbox.h"
+#include "freesite.h"
+#include "netlistcsr.h"
+#include "movegen.h"
+#include "netfitness.h"
+#include "movejournal.h"
+#include "besttracker.h"
+#include "tilepin.h"
+#include "steinercache.h"
 // 计时
 #include <chrono>
 
@@ -15,6 +24,8 @@
 // #define EXTERITER  //是否固定外部循环次数
 #define INFO  //是否输出每次的迭代信息
 #define TIME_LIMIT 1180
+// #define HPWL_COST  //使用增量外包矩形的半周线长作为cost，代替flute线长
+// #define BIGNET_APPROX HD_RMST  //bigNet改用近似线长模型参与增量cost，引脚数超过HD_APPROX_D的net用该模型；注释掉则忽略bigNet，定期批量重算
 
 // 全局随机数生成器
 std::mt19937 &get_random_engine()
@@ -63,235 +74,69 @@ double calculateStandardDeviation(const std::vector<int> &data)
     return std::sqrt(variance / data.size());
 }
 
-// 计算rangeActulMap
-int calculrangeMap(bool isBaseline, std::map<int, int> &rangeActualMap)
+// 按fitness偏向地随机选取net，返回net下标
+static int selectNetIdx(const NetFitness &netFitness, const FlatNetlist &flat)
 {
-    for (auto iter : glbNetMap)
-    {
-        Net *net = iter.second;
-        // 访问net input 引脚
-        Instance *instIn = net->getInpin()->getInstanceOwner();
-        int x, y, z;
-        if (isBaseline)
-        {
-            std::tie(x, y, z) = instIn->getBaseLocation();
-        }
-        else
-        {
-            std::tie(x, y, z) = instIn->getLocation();
-        }
-        int maxX, minX, maxY, minY;
-        maxX = minX = x;
-        maxY = minY = y;
-        // 访问net output 引脚
-        std::list<Pin *> outputPins = net->getOutputPins();
-        for (Pin *pin : outputPins)
-        {
-            Instance *instTmp = pin->getInstanceOwner();
-            if (isBaseline)
-            {
-                std::tie(x, y, z) = instTmp->getBaseLocation();
-            }
-            else
-            {
-                std::tie(x, y, z) = instTmp->getLocation();
-            }
-            if (maxX < x)
-                maxX = x;
-            if (minX > x)
-                minX = x;
-            if (maxY < y)
-                maxY = y;
-            if (minY > y)
-                minY = y;
-        }
-        int netDesired = std::ceil((maxX - minX + maxY - minY) / 2);
-        // int netDesired = std::ceil((maxX-minX+maxY-minY));
-        rangeActualMap[net->getId()] = netDesired;
-    }
-    return 0;
-}
-
-//优化，循环体中只计算相关的
-int calculRelatedRangeMap(bool isBaseline, std::map<int, int>& rangeActualMap, const std::set<int>& instRelatedNetId){
-    for(int i : instRelatedNetId){
-        Net *net = glbNetMap[i];
-        // 访问net input 引脚
-        Instance *instIn = net->getInpin()->getInstanceOwner();
-        int x, y, z;
-        if (isBaseline)
-        {
-            std::tie(x, y, z) = instIn->getBaseLocation();
-        }
-        else
-        {
-            std::tie(x, y, z) = instIn->getLocation();
+    int netIdx = netFitness.sampleNet(get_random_engine());
+    //跳过bigNet
+    if(glbBigNetPinNum > 0){
+        while(glbBigNet.find(flat.getNetId(netIdx)) != glbBigNet.end()){
+            netIdx = netFitness.sampleNet(get_random_engine());
         }
-        int maxX, minX, maxY, minY;
-        maxX = minX = x;
-        maxY = minY = y;
-        // 访问net output 引脚
-        std::list<Pin *> outputPins = net->getOutputPins();
-        for (Pin *pin : outputPins)
-        {
-            Instance *instTmp = pin->getInstanceOwner();
-            if (isBaseline)
-            {
-                std::tie(x, y, z) = instTmp->getBaseLocation();
-            }
-            else
-            {
-                std::tie(x, y, z) = instTmp->getLocation();
-            }
-            if (maxX < x)
-                maxX = x;
-            if (minX > x)
-                minX = x;
-            if (maxY < y)
-                maxY = y;
-            if (minY > y)
-                minY = y;
-        }
-        int netDesired = std::ceil((maxX - minX + maxY - minY) / 2);
-        // int netDesired = std::ceil((maxX-minX+maxY-minY));
-        rangeActualMap[net->getId()] = netDesired;
     }
-    return 0;
+    return netIdx;
 }
 
-// 计算Fitness
-int calculFitness(std::vector<std::pair<int, float>> &fitnessVec, std::map<int, int> &rangeDesiredMap, std::map<int, int> &rangeActualMap)
+// 按glbBigNet标记FlatNetlist中的bigNet，bigNet不参与增量cost
+static void markBigNets(const FlatNetlist &flat, std::vector<char> &isBigNet)
 {
-    // 计算fitness
-    int n = fitnessVec.size();
-    for (int i = 0; i < n; i++)
+    isBigNet.assign(flat.getNumNets(), 0);
+    if (glbBigNetPinNum <= 0)
+        return;
+    for (int netId : glbBigNet)
     {
-        int netId = fitnessVec[i].first;
-        float fitness;
-        int rangeDesired = rangeDesiredMap[netId];
-        int rangeActual = rangeActualMap[netId];
-        if (rangeDesired == 0 && rangeActual == 0)
-        {
-            fitness = 1; // 都为0则不考虑移动了，认为为最完美的net
-        }
-        else if (rangeDesired >= rangeActual)
-        {
-            fitness = rangeActual / rangeDesired;
-        }
-        else
-        {
-            fitness = rangeDesired / rangeActual;
-        }
-        fitnessVec[i] = std::make_pair(netId, fitness);
+        int idx = flat.getNetIndex(netId);
+        if (idx != -1)
+            isBigNet[idx] = 1;
     }
-    return 0;
 }
 
-// 优化 只计算相关的fitness
-int calculRelatedFitness(std::vector<std::pair<int, float>> &fitnessVec, std::map<int, int> &rangeDesiredMap, std::map<int, int> &rangeActualMap, const std::set<int> &instRelatedNetId)
+// inst及一起移动的matchedInst相关的net下标（不含bigNet），升序去重，relatedNets在SA中重复使用
+static void collectRelatedNets(const FlatNetlist &flat, const std::vector<char> &isBigNet, Instance *inst, Instance *matchedInst, std::vector<int> &relatedNets)
 {
-    // 计算fitness
-    int n = fitnessVec.size();
-    for(auto netId : instRelatedNetId){
-        int index = -1; 
-        //找到匹配netId的下标
-        for (int i = 0; i < fitnessVec.size(); ++i) {
-            if (fitnessVec[i].first == netId) {
-                index = i;
-                break;
-            }
-        }
-        #ifdef DEBUG
-        if(index == -1){
-            std::cout<<"can not find this netId: "<<netId <<", something may be wrong"<<std::endl;
-            exit(1);
-        }
-        #endif
-        int rangeDesired = rangeDesiredMap[netId];
-        int rangeActual = rangeActualMap[netId];
-        float fitness;
-        if (rangeDesired == 0 && rangeActual == 0)
-        {
-            fitness = 1; // 都为0则不考虑移动了，认为为最完美的net
-        }
-        else if (rangeDesired >= rangeActual)
-        {
-            fitness = rangeActual / rangeDesired;
-        }
-        else
+    relatedNets.clear();
+    Instance *insts[2] = {inst, matchedInst};
+    for (Instance *it : insts)
+    {
+        if (it == nullptr)
+            continue;
+        int instIdx = flat.getInstIndex(it);
+        if (instIdx == -1)
+            continue;
+        for (const int *n = flat.getInstNetsBegin(instIdx); n != flat.getInstNetsEnd(instIdx); ++n)
         {
-            fitness = rangeDesired / rangeActual;
+            if (!isBigNet[*n])
+                relatedNets.push_back(*n);
         }
-        fitnessVec[index] = std::make_pair(netId, fitness);
     }
-    return 0;
-}
-
-int sortedFitness(std::vector<std::pair<int, float>> &fitnessVec)
-{ // 将fitnessVec按第二个值升序排列
-    std::sort(fitnessVec.begin(), fitnessVec.end(), [](const std::pair<int, float> &a, const std::pair<int, float> &b)
-              {
-                  return a.second < b.second; // 按照 float 值从小到大排序
-              });
-    return 0;
-}
-
-int selectNetId(std::vector<std::pair<int, float>> &fitnessVec)
-{ // 返回具有一定规律随机选取的net
-    int n = fitnessVec.size();
-    int a = generate_random_int(0, n - 1); // 范围在 0 到 n - 1
-    int b = generate_random_int(0, n - 1);
-    int index = std::min(a, b);
-    int netId = fitnessVec[index].first;
-
-    //跳过bigNet
-    if(glbBigNetPinNum > 0){
-        while(glbBigNet.find(netId) != glbBigNet.end()){
-            a = generate_random_int(0, n - 1); // 范围在 0 到 n - 1
-            b = generate_random_int(0, n - 1);
-            index = std::min(a, b);
-            netId = fitnessVec[index].first;
-        }
+    if (matchedInst != nullptr)
+    {
+        std::sort(relatedNets.begin(), relatedNets.end());
+        relatedNets.erase(std::unique(relatedNets.begin(), relatedNets.end()), relatedNets.end());
     }
-
-    return netId;
 }
 
-Instance* selectInst(Net *net){ //返回在net中随机选取的instance指针
-    std::list<Pin*>& pinList = net->getOutputPins();
-    pinList.emplace_back(net->getInpin());
-    int n = pinList.size(); //
-    Instance *inst = nullptr;
-    std::vector<int> numbers(n);                  // 0到n-1的数字
-    std::iota(numbers.begin(), numbers.end(), 0); // 填充从0到n的数字
-    while (!numbers.empty())
+std::pair<int, int> getNetCenter(bool isBaseline, Net *net)
+{ // 返回net的中心位置
+    const FlatNetlist *flats[2] = {&glbFlatNetlist, &glbFlatPackNetlist};
+    for (const FlatNetlist *flat : flats)
     {
-        int randomIndex = generate_random_int(0, numbers.size() - 1);
-        int index = numbers[randomIndex];
-
-        // 创建一个迭代器指向 list 的开始
-        std::list<Pin *>::iterator it = pinList.begin();
-        // 使用 std::advance 移动迭代器到指定下标
-        std::advance(it, index);
-        inst = (*it)->getInstanceOwner();
-
-        // 检查是否符合规则
-        if (inst->isFixed())
-        {
-            // 移除不符合规则的数字
-            numbers.erase(numbers.begin() + randomIndex);
-            inst = nullptr;
-        }
-        else
+        int idx = flat->findNet(net);
+        if (idx != -1)
         {
-            break;
+            return flat->getNetCenter(idx, isBaseline);
         }
     }
-    return inst;
-}
-
-std::pair<int, int> getNetCenter(bool isBaseline, Net *net)
-{ // 返回net的中心位置
     int x = 0, y = 0;
     std::set<int> visitInst; // 记录访问过的inst的id，防止一个inst有多个引脚在同一net且计算多次的情况
     // 统计inpin
@@ -356,237 +201,212 @@ std::pair<int, int> getNetCenter(bool isBaseline, Net *net)
     return std::make_pair(x, y);
 }
 
-bool isValid(bool isBaseline, int x, int y, int &z, Instance *inst)
-{ // 判断这个位置是否可插入该inst，如果可插入则返回z值
-    bool valid = false;
-    Tile *tile = chip.getTile(x, y);
-    // if(tile == NULL || tile->matchType("PLB") == false){
-    //     return false;
-    // }
-    std::string instType = inst->getModelName();
-    std::string instName = inst->getInstanceName();
-    int instId = std::stoi(inst->getInstanceName().substr(5)); // inst_xxx 从第5个字符开始截取，转换为整数
-    if (instType.substr(0, 3) == "LUT")
+// 根据DRAM占用确定LUT可用的slot范围，两个DRAM都被占用时返回false
+static bool getLutRange(const TileOccupancy &occ, int &lutBegin, int &lutEnd)
+{
+    // DRAM at slot0 blocks lut slot 0~3
+    // DRAM at slot1 blocks lut slot 4~7
+    if ((occ.dramUsed & 0x3) == 0x3)
     {
-        std::vector<int> hasDRAM(2, 0); //  1 表示有DRAM
-        // 先判断是否有DRAM
-        slotArr dramSlotArr = *(tile->getInstanceByType("DRAM"));
-        slotArr lutSlotArr = *(tile->getInstanceByType("LUT"));
-        int lutBegin = 0, lutEnd = 0;
-        for (int idx = 0; idx < (int)dramSlotArr.size(); idx++)
-        {
-            Slot *slot = dramSlotArr[idx];
-            if (slot == nullptr)
-            {
-                continue;
-            }
-            std::list<int> instances;
-            if (isBaseline)
-            {
-                instances = slot->getBaselineInstances();
-            }
-            else
-            {
-                instances = slot->getOptimizedInstances();
-            }
-            if (instances.empty())
-            {
-                continue;
-            }
-            // DRAM at slot0 blocks lut slot 0~3
-            // DRAM at slot1 blocks lut slot 4~7
-            hasDRAM[idx] = 1;
+        return false;
+    }
+    else if (occ.dramUsed & 0x1)
+    {
+        lutBegin = 4;
+        lutEnd = 8;
+    }
+    else if (occ.dramUsed & 0x2)
+    {
+        lutBegin = 0;
+        lutEnd = 4;
+    }
+    else
+    {
+        lutBegin = 0;
+        lutEnd = 8;
+    }
+    return true;
+}
+
+// 配对的LUT需要整个slot都是空的
+static bool findEmptyLutSlot(const TileOccupancy &occ, int lutBegin, int lutEnd, int &z)
+{
+    for (int idx = lutBegin; idx < lutEnd; idx++)
+    {
+        if (occ.lutCount[idx] == 0)
+        {
+            z = idx;
+            return true;
         }
-        if (hasDRAM[0] && hasDRAM[1])
+    }
+    return false;
+}
+
+// 找放入inst后输入net并集最大且不超过6的slot
+static bool findLutSlot(const TileOccupancy &occ, Instance *inst, int lutBegin, int lutEnd, bool isPack, int &z)
+{
+    // inst自身的输入net（去重）
+    int instNets[MAX_OCC_LUT_NETS];
+    int numInstNets = 0;
+    for (int i = 0; i < inst->getNumInpins(); i++)
+    {
+        int netID = inst->getInpin(i)->getNetID();
+        if (netID == -1 || std::find(instNets, instNets + numInstNets, netID) != instNets + numInstNets)
         {
-            // 两个都是DRAM，不可放置
-            return false;
+            continue;
         }
-        // 0-3不可放
-        else if (hasDRAM[0])
+        if (numInstNets == MAX_OCC_LUT_NETS)
         {
-            lutBegin = 4;
-            lutEnd = 8;
+            return false;
         }
-        // 4-7不可放
-        else if (hasDRAM[1])
+        instNets[numInstNets++] = netID;
+    }
+    int best = -1, bestSize = -1;
+    for (int idx = lutBegin; idx < lutEnd; idx++)
+    {
+        int count = occ.lutCount[idx];
+        if (count > 1)
         {
-            lutBegin = 0;
-            lutEnd = 4;
+            // 大于1个lut，不可放入了
+            continue;
         }
-        // 都可以放
-        else
+        if (isPack && count == 1 && ((occ.lutPacked >> idx) & 1))
         {
-            lutBegin = 0;
-            lutEnd = 8;
+            // 已经是打包好的LUT对
+            continue;
         }
-        // 新加的 cjq 1104
-        if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
+        const NetRefTable<MAX_OCC_LUT_NETS> &table = occ.lutInputNets[idx];
+        int totalInputs = table.size();
+        for (int i = 0; i < numInstNets; i++)
         {
-            for (int idx = lutBegin; idx < lutEnd; idx++)
-            {
-                Slot *slot = lutSlotArr[idx];
-                if (slot == nullptr)
-                {
-                    continue;
-                }
-                std::list<int> instances;
-                if (isBaseline)
-                {
-                    instances = slot->getBaselineInstances();
-                }
-                else
-                {
-                    instances = slot->getOptimizedInstances();
-                }
-                if (instances.size() == 0)
-                {
-                    // 找到整个位置都是空的
-                    z = idx;
-                    return true;
-                }
-            }
-            return false;
+            if (!table.contains(instNets[i]))
+                totalInputs++;
         }
-        std::vector<std::pair<int, int>> record; // 记录每个引脚小于6的 lut  [idx, pinNum]
-        for (int idx = lutBegin; idx < lutEnd; idx++)
+        if (totalInputs <= 6 && totalInputs > bestSize)
         {
-            Slot *slot = lutSlotArr[idx];
-            if (slot == nullptr)
-            {
-                continue;
-            }
-            std::list<int> instances;
-            if (isBaseline)
-            {
-                instances = slot->getBaselineInstances();
-            }
-            else
-            {
-                instances = slot->getOptimizedInstances();
-            }
-            if (instances.size() <= 1)
-            {
-                // 大于1个lut，不可放入了
-                instances.push_back(instId); // 添加当前instId
-                std::set<int> totalInputs;
-                for (auto instID : instances)
-                {
-                    Instance *instPtr = glbInstMap.find(instID)->second;
-                    std::vector<Pin *> inpins = instPtr->getInpins();
-                    for (auto pin : inpins)
-                    {
-                        if (pin->getNetID() != -1)
-                        {
-                            totalInputs.insert(pin->getNetID());
-                        }
-                    }
-                }
-                if (totalInputs.size() <= 6)
-                {
-                    // 符合条件 记录
-                    record.emplace_back(std::make_pair(idx, totalInputs.size()));
-                }
-            }
+            best = idx;
+            bestSize = totalInputs;
         }
-        if (record.size() != 0)
+    }
+    if (best == -1)
+    {
+        return false;
+    }
+    z = best;
+    return true;
+}
+
+// 判断bank放入inst后控制集是否超过限制
+static bool seqBankAccepts(const TileOccupancy &occ, int bank, Instance *inst)
+{
+    NetRefTable<MAX_OCC_CTRL_NETS> clkNets = occ.clkNets[bank]; // 不超过1
+    NetRefTable<MAX_OCC_CTRL_NETS> ceNets = occ.ceNets[bank];   // 不超过2
+    NetRefTable<MAX_OCC_CTRL_NETS> srNets = occ.srNets[bank];   // 不超过1
+    for (int i = 0; i < inst->getNumInpins(); i++)
+    {
+        Pin *pin = inst->getInpin(i);
+        int netID = pin->getNetID();
+        if (netID < 0)
+            continue;
+        PinProp prop = pin->getProp();
+        if (prop == PIN_PROP_CE)
+            ceNets.add(netID);
+        else if (prop == PIN_PROP_CLOCK)
+            clkNets.add(netID);
+        else if (prop == PIN_PROP_RESET)
+            srNets.add(netID);
+    }
+    return clkNets.size() <= MAX_TILE_CLOCK_PER_PLB_BANK && ceNets.size() <= MAX_TILE_CE_PER_PLB_BANK && srNets.size() <= MAX_TILE_RESET_PER_PLB_BANK;
+}
+
+static bool findEmptySeqSlot(const TileOccupancy &occ, int bank, int &z)
+{
+    // bank0 0-8   bank1 8-16
+    for (int i = bank * 8; i < (bank + 1) * 8; i++)
+    {
+        if (((occ.seqUsed >> i) & 1) == 0)
         {
-            // 按第二个元素降序排序
-            std::sort(record.begin(), record.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b)
-                      {
-                          return a.second > b.second; // 使用 > 实现降序
-                      });
-            z = record[0].first;
+            z = i;
             return true;
         }
     }
-    else if (inst->getModelName() == "SEQ")
+    return false;
+}
+
+bool isValid(bool isBaseline, int x, int y, int &z, Instance *inst)
+{ // 判断这个位置是否可插入该inst，如果可插入则返回z值
+    const TileOccupancy &occ = chip.getTile(x, y)->getOccupancy(isBaseline);
+    const std::string &instType = inst->getModelName();
+    if (instType.compare(0, 3, "LUT") == 0)
+    {
+        int lutBegin, lutEnd;
+        if (!getLutRange(occ, lutBegin, lutEnd))
+        {
+            // 两个都是DRAM，不可放置
+            return false;
+        }
+        // 新加的 cjq 1104
+        if (inst->getMatchedLUTID() != -1)
+        {
+            return findEmptyLutSlot(occ, lutBegin, lutEnd, z);
+        }
+        return findLutSlot(occ, inst, lutBegin, lutEnd, false, z);
+    }
+    else if (instType == "SEQ")
     {
-        slotArr seqSlotArr = *(tile->getInstanceByType("SEQ"));
         for (int bank = 0; bank < 2; bank++)
         {
-            // bank0 0-8   bank1 8-16
-            int start = bank * 8;
-            int end = (bank + 1) * 8;
-            std::set<int> instIdSet;
-            instIdSet.insert(instId); // 添加当前Id
-            for (int i = start; i < end; i++)
-            {
-                Slot *slot = seqSlotArr[i];
-                std::list<int> instList;
-                if (isBaseline)
-                    instList = slot->getBaselineInstances();
-                else
-                    instList = slot->getOptimizedInstances();
-                for (int id : instList)
-                {
-                    instIdSet.insert(id);
-                }
-            }
-            // 判断每个inst的引脚
-            std::set<int> clkNets; // 不超过1
-            std::set<int> ceNets;  // 不超过2
-            std::set<int> srNets;  // 不超过1
-            for (int i : instIdSet)
+            // SEQ只要返回一个空位子即可
+            if (seqBankAccepts(occ, bank, inst) && findEmptySeqSlot(occ, bank, z))
             {
-                Instance *instPtr = glbInstMap[i];
-                int numInpins = instPtr->getNumInpins();
-                for (int i = 0; i < numInpins; i++)
-                {
-                    // 只判断input是否是这几个量
-                    Pin *pin = instPtr->getInpin(i);
-                    int netID = pin->getNetID();
-                    if (netID >= 0)
-                    {
-                        PinProp prop = pin->getProp();
-                        if (prop == PIN_PROP_CE)
-                        {
-                            ceNets.insert(netID);
-                        }
-                        else if (prop == PIN_PROP_CLOCK)
-                        {
-                            clkNets.insert(netID);
-                        }
-                        else if (prop == PIN_PROP_RESET)
-                        {
-                            srNets.insert(netID);
-                        }
-                    }
-                }
+                return true;
             }
+        }
+    }
+    return false;
+}
 
-            int numClk = clkNets.size();
-            int numReset = srNets.size();
-            int numCe = ceNets.size();
+// 从空闲位置索引中随机采样，返回true表示结果已确定（找到位置，或窗口内没有候选）
+static bool sampleFreeSite(bool isBaseline, int xl, int xr, int yl, int yr, Instance *inst, bool isPack, bool isSeqPack, std::tuple<int, int, int> &result)
+{
+    std::string instType = inst->getModelName().substr(0, 3);
+    int siteType;
+    if (instType == "LUT")
+        siteType = FreeSiteIndex::SITE_LUT;
+    else if (instType == "SEQ")
+        siteType = FreeSiteIndex::SITE_SEQ;
+    else
+        return false;
+    int xCur, yCur, zCur;
+    if (isBaseline)
+        std::tie(xCur, yCur, zCur) = inst->getBaseLocation();
+    else
+        std::tie(xCur, yCur, zCur) = inst->getLocation();
 
-            if (numClk > MAX_TILE_CLOCK_PER_PLB_BANK || numCe > MAX_TILE_CE_PER_PLB_BANK || numReset > MAX_TILE_RESET_PER_PLB_BANK)
-            {
-                // 该bank放入该inst时违反约束
-                valid = false;
-            }
-            else
-            {
-                // SEQ只要返回一个空位子即可
-                // slotArr seqSlotArr = *(tile->getInstanceByType("SEQ"));
-                for (int i = start; i < end; i++)
-                {
-                    Slot *slot = seqSlotArr[i];
-                    std::list<int> listTmp;
-                    if (isBaseline)
-                        listTmp = slot->getBaselineInstances();
-                    else
-                        listTmp = slot->getOptimizedInstances();
-                    if (listTmp.size() == 0)
-                    {
-                        z = i;
-                        return true;
-                    }
-                }
-            }
+    result = std::make_tuple(-1, -1, -1);
+    int total = glbFreeSiteIndex.count(siteType, xl, xr, yl, yr);
+    if (total == 0)
+    {
+        return true;
+    }
+    const int maxRetry = 32;
+    for (int retry = 0; retry < maxRetry; retry++)
+    {
+        int xx, yy, zz = -1;
+        glbFreeSiteIndex.sample(siteType, xl, xr, yl, yr, generate_random_int(0, total - 1), xx, yy);
+        if (xCur == xx && yCur == yy)
+        {
+            continue;
+        }
+        bool valid = isPack ? isPackValid(isBaseline, xx, yy, zz, inst, isSeqPack) : isValid(isBaseline, xx, yy, zz, inst);
+        if (valid)
+        {
+            result = std::make_tuple(xx, yy, zz);
+            return true;
         }
     }
-
-    return valid;
+    // 多次采样都不满足约束，退回到枚举
+    return false;
 }
 
 std::tuple<int, int, int> findSuitableLoc(bool isBaseline, int x, int y, int rangeDesired, Instance *inst)
@@ -606,6 +426,12 @@ std::tuple<int, int, int> findSuitableLoc(bool isBaseline, int x, int y, int ran
     if (yr > numRow)
         yr = numRow;
 
+    std::tuple<int, int, int> sampled;
+    if (glbFreeSiteIndex.isBuilt() && sampleFreeSite(isBaseline, xl, xr, yl, yr, inst, false, false, sampled))
+    {
+        return sampled;
+    }
+
     // 生成矩形框内的所有坐标
     std::vector<std::pair<int, int>> coordinates;
     for (int x = xl; x <= xr; ++x)
@@ -670,121 +496,86 @@ int changeTile(bool isBaseline, std::tuple<int, int, int> originLoc, std::tuple<
     std::tie(xGoal, yGoal, zGoal) = loc;
     Tile *tileCur = chip.getTile(xCur, yCur);
     Tile *tileGoal = chip.getTile(xGoal, yGoal);
-    int instId = std::stoi(inst->getInstanceName().substr(5)); // inst_xxx 从第5个字符开始截取，转换为整数
-    // 删除旧的tile插槽中的inst
-    slotArr *slotArrCur = tileCur->getInstanceByType(inst->getModelName().substr(0, 3)); // LUT or SEQ
-    Slot *slot = slotArrCur->at(zCur);
-    if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
+    int instId = inst->getInstID();
+    const std::string &modelType = inst->getModelName();
+    if (inst->getMatchedLUTID() != -1 && modelType.compare(0, 3, "LUT") == 0)
     {
-        if (isBaseline)
-            slot->clearBaselineInstances();
-        else
-            slot->clearOptimizedInstances();
+        // 配对的LUT一起移动
+        tileCur->clearSlot(zCur, modelType, isBaseline);
         // 添加到新的tile
-        tileGoal->addInstance(instId, zGoal, inst->getModelName(), isBaseline);
-        tileGoal->addInstance(inst->getMatchedLUTID(), zGoal, inst->getModelName(), isBaseline);
+        tileGoal->addInstance(instId, zGoal, modelType, isBaseline);
+        tileGoal->addInstance(inst->getMatchedLUTID(), zGoal, modelType, isBaseline);
     }
     else
     {
-        if (isBaseline)
-        {
-            std::list<int> &instances = slot->getBaselineInstances();
-            for (int instIdTmp : instances)
-            {
-                if (instId == instIdTmp)
-                {
-                    instances.remove(instIdTmp);
-                    break;
-                }
-            }
-        }
-        else
-        {
-            std::list<int> &instances = slot->getOptimizedInstancesRef();
-            for (int instIdTmp : instances)
-            {
-                if (instId == instIdTmp)
-                {
-                    instances.remove(instIdTmp);
-                    break;
-                }
-            }
-        }
-        // 在新的插槽中插入
-        tileGoal->addInstance(instId, zGoal, inst->getModelName(), isBaseline);
+        // 删除旧的tile插槽中的inst，在新的插槽中插入
+        tileCur->removeInstanceAt(instId, zCur, modelType, isBaseline);
+        tileGoal->addInstance(instId, zGoal, modelType, isBaseline);
     }
 
     return 0;
 }
 
 
-//删除旧值，插入新值
+// 按当前tile重新计算pin密度
+static void updatePinDensity(std::tuple<int,int,int> loc){
+    glbPinDensity.set(std::get<0>(loc) * 1000 + std::get<1>(loc), getPinDensityByXY(std::get<0>(loc), std::get<1>(loc)));
+}
 
-bool tryUpdatePinDensity(std::tuple<int,int,int> originLoc, std::tuple<int,int,int> loc){
-    int originLocIndex = std::get<0>(originLoc) * 1000 + std::get<1>(originLoc);
-    int locIndex = std::get<0>(loc) * 1000 + std::get<1>(loc);
-    //获取旧的pin密度
-    int oldOriginLocPD = 0;
-    int oldLocPD = 0;
-    auto itOrigin = std::find_if(glbPinDensity.begin(), glbPinDensity.end(), [originLocIndex](const std::pair<int, int>& p) {
-        return p.first == originLocIndex;
-    });
-    if (itOrigin != glbPinDensity.end()) {
-        oldOriginLocPD = itOrigin->second;
-    } 
-    auto it = std::find_if(glbPinDensity.begin(), glbPinDensity.end(), [locIndex](const std::pair<int, int>& p) {
-        return p.first == locIndex;
-    });
-    if (it != glbPinDensity.end()) {
-        oldLocPD = it->second;
-    } 
-
-    //获取新的pin密度分子
-    int newOriginLocPD = getPinDensityByXY(std::get<0>(originLoc), std::get<1>(originLoc));
-    int newLocPD = getPinDensityByXY(std::get<0>(loc), std::get<1>(loc));
-
-    //修改
-    if(itOrigin == glbPinDensity.end()){
-        glbPinDensity.emplace_back(std::make_pair(originLocIndex, newOriginLocPD));
-    }
-    else{
-        itOrigin->second = newOriginLocPD;
-    }
-    if(it == glbPinDensity.end()){
-        glbPinDensity.emplace_back(std::make_pair(locIndex, newLocPD));
+// 日志撤销完之后把快照中的inst写回最优位置，先全部从当前tile删除，再插入，避免目标slot还被没写回的inst占着
+// moved返回实际移动的inst与写回前的坐标
+static void writeBackSnapshot(bool isBaseline, bool isSeqPack, const BestTracker &bestTracker, std::vector<BestTracker::SnapshotEntry> &moved)
+{
+    const std::vector<BestTracker::SnapshotEntry> &snapshot = bestTracker.getSnapshot();
+    std::vector<int> movedIdx;
+    moved.clear();
+    for (int i = 0; i < (int)snapshot.size(); i++)
+    {
+        Instance *inst = snapshot[i].first;
+        std::tuple<int, int, int> curLoc = isBaseline ? inst->getBaseLocation() : inst->getLocation();
+        if (curLoc != snapshot[i].second)
+        {
+            movedIdx.push_back(i);
+            moved.emplace_back(inst, curLoc);
+        }
     }
-    else{
-        it->second = newLocPD;
+    for (auto &it : moved)
+    {
+        removePackTile(isBaseline, it.second, it.first);
     }
-    
-
-    //排序
-    std::sort(glbPinDensity.begin(), glbPinDensity.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-        return a.second > b.second; // 按值降序排序
-    });
-    itOrigin = std::find_if(glbPinDensity.begin(), glbPinDensity.end(), [originLocIndex](const std::pair<int, int>& p) {
-        return p.first == originLocIndex;
-    });
-    it = std::find_if(glbPinDensity.begin(), glbPinDensity.end(), [locIndex](const std::pair<int, int>& p) {
-        return p.first == locIndex;
-    });
-
-
-    // 计算新和
-    int potentialSum = 0;
-    int i = 0;
-    for(auto& it : glbPinDensity){
-        if(i >= glbTopKNum){
-            break;
-        }
-        potentialSum += it.second;
-        i++;
+    for (int i : movedIdx)
+    {
+        addPackTile(isBaseline, snapshot[i].second, snapshot[i].first, isSeqPack);
+        if (isBaseline)
+            snapshot[i].first->setBaseLocation(snapshot[i].second);
+        else
+            snapshot[i].first->setLocation(snapshot[i].second);
     }
-    
-    if (potentialSum > glbInitTopSum) {
+    for (int k = 0; k < (int)moved.size(); k++)
+    {
+        const std::tuple<int, int, int> &loc = snapshot[movedIdx[k]].second;
+        glbFreeSiteIndex.updateTile(std::get<0>(moved[k].second), std::get<1>(moved[k].second));
+        glbFreeSiteIndex.updateTile(std::get<0>(loc), std::get<1>(loc));
+    }
+}
+
+//删除旧值，插入新值
+
+bool tryUpdatePinDensity(std::tuple<int,int,int> originLoc, std::tuple<int,int,int> loc){
+    int originLocIndex = std::get<0>(originLoc) * 1000 + std::get<1>(originLoc);
+    int locIndex = std::get<0>(loc) * 1000 + std::get<1>(loc);
+    //获取旧的pin密度
+    int oldOriginLocPD = glbPinDensity.get(originLocIndex);
+    int oldLocPD = glbPinDensity.get(locIndex);
+
+    //获取新的pin密度分子并修改
+    glbPinDensity.set(originLocIndex, getPinDensityByXY(std::get<0>(originLoc), std::get<1>(originLoc)));
+    glbPinDensity.set(locIndex, getPinDensityByXY(std::get<0>(loc), std::get<1>(loc)));
+
+    if (glbPinDensity.getTopSum() > glbInitTopSum) {
         //复原
-        itOrigin->second = oldOriginLocPD;
-        it->second = oldLocPD;
+        glbPinDensity.set(locIndex, oldLocPD);
+        glbPinDensity.set(originLocIndex, oldOriginLocPD);
         return false;
     }
     else{
@@ -799,24 +590,17 @@ int arbsa(bool isBaseline, std::string nodesFile){
 
     // 初始布局
 
-    // 懒加载，算到再加进去，用空间换时间。key: instId  value: instRelatedNetId
-    std::map<int, std::set<int>> instRelatedNetIdMap;
-
-    // 构造 fitness 优先级列表 初始化 rangeDesired
-    std::vector<std::pair<int, float>> fitnessVec; // 第一个是netId，第二个是适应度fitness, 适应度越小表明越需要移动。后续会按照fitness升序排列
-    std::map<int, int> rangeDesiredMap;            // 第一个是netId，第二个是外框矩形的平均跨度，即半周线长的一半
-    calculrangeMap(isBaseline, rangeDesiredMap);
-    for (auto it : glbNetMap)
-    {
-        Net *net = it.second;
-        // 构造fitnessVec
-        fitnessVec.emplace_back(std::make_pair(net->getId(), 0));
-    }
-    std::map<int, int> rangeActualMap(rangeDesiredMap); // 第一个是netId，第二个是当前实际的外框矩形的平均跨度，即半周线长的一半
-
-    // 计算 fitness 并 排序
-    calculFitness(fitnessVec, rangeDesiredMap, rangeActualMap);
-    sortedFitness(fitnessVec);
+    glbFlatNetlist.build(glbNetMap);
+    glbMoveGen.build(glbFlatNetlist, isBaseline);
+    // 移动相关的net下标（glbFlatNetlist），每次移动重复使用
+    std::vector<int> relatedNets;
+    std::vector<char> isBigNet;
+    markBigNets(glbFlatNetlist, isBigNet);
+    // 构造 fitness 优先级结构 初始化 rangeDesired
+    NetFitness netFitness;
+    netFitness.build(glbFlatNetlist, isBaseline);
+    MoveJournal journal;
+    BestTracker bestTracker;
 
     // 初始化迭代次数Iter、初始化温度T
     int Iter = 0;
@@ -827,7 +611,15 @@ int arbsa(bool isBaseline, std::string nodesFile){
     const int timeLimit = TIME_LIMIT; //1180  3580
     // 计算初始cost
     int cost = 0, costNew = 0;
+    invalidateWirelengthCache(glbNetMap);
+    chip.rebuildTileOccupancy();
+#ifdef HPWL_COST
+    glbNetBBox.build(glbNetMap, isBaseline);
+    cost = glbNetBBox.getTotalHPWL();
+#else
     cost = getWirelength(isBaseline);
+#endif
+    glbFreeSiteIndex.build(isBaseline);
     // cost = getHPWL(isBaseline);
     // 自适应参数
     int counterNet = 0;
@@ -840,53 +632,34 @@ int arbsa(bool isBaseline, std::string nodesFile){
     for (int i = 0; i < 50; i++)
     {
         // 计算50次步骤取方差
-        int netId = selectNetId(fitnessVec);
-        Net *net = glbNetMap[netId];
-        Instance *inst = selectInst(net);
+        int netIdx = selectNetIdx(netFitness, glbFlatNetlist);
+        Instance *inst = glbMoveGen.selectInst(netIdx, get_random_engine());
         if (inst == nullptr)
         {
             // 没找到可移动的inst，跳过后续部分
             continue;
         }
         int centerX, centerY;
-        std::tie(centerX, centerY) = getNetCenter(isBaseline, net);
+        std::tie(centerX, centerY) = glbMoveGen.getNetCenter(netIdx);
         int x, y, z;
-        std::tie(x, y, z) = findSuitableLoc(isBaseline, centerX, centerY, rangeDesiredMap[netId], inst);
+        std::tie(x, y, z) = findSuitableLoc(isBaseline, centerX, centerY, netFitness.getDesiredRange(netIdx), inst);
         if (z == -1)
         {
             // 没找到合适位置
             continue;
         }
         // 找到这个inst附近的net
-        std::set<int> instRelatedNetId;
-        // 访问inputpin
-        for (auto &pin : inst->getInpins())
-        {
-            int netId = pin->getNetID();
-            //-1表示未连接
-            if(netId == -1) continue;
-            if(glbBigNetPinNum > 0 && glbBigNet.find(netId) != glbBigNet.end()){
-                continue;
-            }
-            instRelatedNetId.insert(pin->getNetID());
-        }
-        // 访问outputpin
-        for (auto &pin : inst->getOutpins())
-        {
-            int netId = pin->getNetID();
-            //-1表示未连接
-            if(netId == -1) continue;
-            if(glbBigNetPinNum > 0 && glbBigNet.find(netId) != glbBigNet.end()){
-                continue;
-            }
-            instRelatedNetId.insert(pin->getNetID());
-        }
-        
+        collectRelatedNets(glbFlatNetlist, isBigNet, inst, nullptr, relatedNets);
+        const int *netsBegin = relatedNets.data();
+        const int *netsEnd = netsBegin + relatedNets.size();
+
         // 计算移动后的newCost
         std::tuple<int, int, int> loc = std::make_tuple(x, y, z);
         std::tuple<int, int, int> originLoc;
         // 保存更新前的部分net
-        int beforeNetWL = getRelatedWirelength(isBaseline, instRelatedNetId);
+#ifndef HPWL_COST
+        int beforeNetWL = getCachedFlatWirelength(glbFlatNetlist, isBaseline, netsBegin, netsEnd);
+#endif
         if (isBaseline)
         {
             originLoc = inst->getBaseLocation();
@@ -897,8 +670,12 @@ int arbsa(bool isBaseline, std::string nodesFile){
             originLoc = inst->getLocation();
             inst->setLocation(loc);
         }
-        int afterNetWL = getRelatedWirelength(isBaseline, instRelatedNetId);
+#ifdef HPWL_COST
+        int costNew = cost + glbNetBBox.evalMove(&inst, 1, originLoc, loc);
+#else
+        int afterNetWL = evalFlatWirelength(glbFlatNetlist, isBaseline, netsBegin, netsEnd);
         int costNew = cost - beforeNetWL + afterNetWL;
+#endif
         if (costNew < cost)
         {
             sigmaVecInit.emplace_back(costNew);
@@ -930,18 +707,33 @@ int arbsa(bool isBaseline, std::string nodesFile){
         }
     }
 
+#ifdef BIGNET_APPROX
+    //bigNet的线长由近似模型估计，和其他net一样增量计算，重新计算初始cost
+    rsmt.setHighDegreeModel(BIGNET_APPROX, HD_APPROX_D);
+    glbBigNet.clear();
+    glbBigNetPinNum = 0;
+#ifndef HPWL_COST
+    invalidateWirelengthCache(glbNetMap);
+    cost = getWirelength(isBaseline);
+#endif
+#else
+    //设置引脚数超过该数字的net为bigNet
+    const int pinNumLimit = 5000; //5000
     //记录bigNet的cost
     int bigNetCostPre = 0;
     int bigNetCostCur = 0;
-    //设置引脚数超过该数字的net为bigNet
-    const int pinNumLimit = 5000; //5000
     //填充有超过次数的bigNet
     if(findBigNetId(pinNumLimit)){
         //记录bigNet的cost
         bigNetCostPre = getRelatedWirelength(isBaseline, glbBigNet);
     }
+    //bigNet cost的初值与最优布局时的值，用于结束时核对写回后的cost
+    const int bigNetCostInit = bigNetCostPre;
+    int bestBigNetCost = bigNetCostPre;
     int hitBigNet = 0; //统计修改影响bigNet的点数，用于更新bigNet的线长
     int hitBigNetLimit = glbBigNetPinNum * 0.05; //引脚数的百分之二十
+#endif
+    markBigNets(glbFlatNetlist, isBigNet);
     //计算标准差
     double standardDeviation = calculateStandardDeviation(sigmaVecInit);
     std::cout << "------------------------------------------------\n";
@@ -961,6 +753,7 @@ int arbsa(bool isBaseline, std::string nodesFile){
     int epsilon = 1; // 设置收敛阈值
     int exterIter = 0;
     int costPre = cost;
+    bestTracker.begin(cost);
     // 外层循环 温度大于阈值， 更新一次fitness优先级列表
     while (T > threashhold)
     {
@@ -989,6 +782,7 @@ int arbsa(bool isBaseline, std::string nodesFile){
 #endif
         // updatePinDensityMapAndTopValues(); //更新全局密度
         while(Iter < InnerIter){
+#ifndef BIGNET_APPROX
             /*********** 更新 bigNet cost **************/
             if(glbBigNetPinNum > 0 && hitBigNet >= hitBigNetLimit){
                 //更新bigNet
@@ -1000,6 +794,7 @@ int arbsa(bool isBaseline, std::string nodesFile){
                 // calculRelatedRangeMap(isBaseline, rangeActualMap, glbBigNet);
                 // calculRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, glbBigNet);
             }
+#endif
 
             if(Iter % 100 == 0) {
                 if(iterLimit > 0){
@@ -1030,94 +825,64 @@ int arbsa(bool isBaseline, std::string nodesFile){
             Iter++;
             iterTotal++;
             // 根据fitness列表选择一个net
-            int netId = selectNetId(fitnessVec);
+            int netIdx = selectNetIdx(netFitness, glbFlatNetlist);
 #ifdef DEBUG
-            std::cout << "DEBUG-netId:" << netId << std::endl;
+            std::cout << "DEBUG-netIdx:" << netIdx << std::endl;
 #endif
-            Net *net = glbNetMap[netId];
             // 随机选择net中的一个inst
-            Instance *inst = selectInst(net);
+            Instance *inst = glbMoveGen.selectInst(netIdx, get_random_engine());
             if (inst == nullptr)
             {
                 // 没找到可移动的inst，跳过后续部分
                 continue;
             }
-            if (inst->getInstanceName() == "inst_1613")
-            {
-                int a = 0;
-            }
-            if (inst->getInstanceName() == "inst_1614")
-            {
-                int a = 0;
-            }
 #ifdef DEBUG
             std::cout << "DEBUG-instName:" << inst->getInstanceName() << std::endl;
 #endif
             // 确定net的中心
             int centerX, centerY;
-            std::tie(centerX, centerY) = getNetCenter(isBaseline, net);
+            std::tie(centerX, centerY) = glbMoveGen.getNetCenter(netIdx);
             // 在 rangeDesired 范围内选取一个位置去放置这个inst
             int x, y, z;
-            std::tie(x, y, z) = findSuitableLoc(isBaseline, centerX, centerY, rangeDesiredMap[netId], inst);
+            std::tie(x, y, z) = findSuitableLoc(isBaseline, centerX, centerY, netFitness.getDesiredRange(netIdx), inst);
             if (z == -1)
             {
                 // 没找到合适位置
                 continue;
             }
-            // 空间换时间
             // 找到这个inst附近的net
-            std::set<int> instRelatedNetId;
-            bool instHasBigNet = false; //判断这个inst是否连接到bigNet
-            //访问inputpin
-            for(auto& pin: inst->getInpins()){
-                int netId = pin->getNetID();
-                //-1表示未连接
-                if(netId == -1) continue;
-                if(glbBigNetPinNum > 0 && glbBigNet.find(netId) != glbBigNet.end()){
-                    instHasBigNet = true;
-                    continue;
-                }
-                instRelatedNetId.insert(pin->getNetID());
-            }
-            //访问outputpin
-            for(auto& pin: inst->getOutpins()){
-                int netId = pin->getNetID();
-                //-1表示未连接
-                if(netId == -1) continue;
-                if(glbBigNetPinNum > 0 && glbBigNet.find(netId) != glbBigNet.end()){
-                    instHasBigNet = true;
-                    continue;
-                }
-                instRelatedNetId.insert(pin->getNetID());
-            }
+            //配对的LUT会一起移动，它的net也要算进来，否则缓存的线长会过期
+            Instance *matchedInst = inst->getMatchedLUTID() != -1 ? glbInstMap[inst->getMatchedLUTID()] : nullptr;
+            collectRelatedNets(glbFlatNetlist, isBigNet, inst, matchedInst, relatedNets);
+            const int *netsBegin = relatedNets.data();
+            const int *netsEnd = netsBegin + relatedNets.size();
 
             // 计算移动后的newCost
             std::tuple<int, int, int> loc = std::make_tuple(x, y, z);
-            std::tuple<int, int, int> originLoc;
+            std::tuple<int, int, int> originLoc = isBaseline ? inst->getBaseLocation() : inst->getLocation();
             // 保存更新前的部分net
-            int beforeNetWL = getRelatedWirelength(isBaseline, instRelatedNetId);
-            if (isBaseline)
+#ifndef HPWL_COST
+            int beforeNetWL = getCachedFlatWirelength(glbFlatNetlist, isBaseline, netsBegin, netsEnd);
+#endif
+            // 试探移动，修改都记在journal中，拒绝时撤销
+            journal.begin(isBaseline);
+            journal.setLocation(inst, loc);
+            if (inst->getMatchedLUTID() != -1)
             {
-                originLoc = inst->getBaseLocation();
-                inst->setBaseLocation(loc);
-                if (inst->getMatchedLUTID() != -1)
-                {
-                    Instance *matchedInst = glbInstMap[inst->getMatchedLUTID()];
-                    matchedInst->setBaseLocation(loc);
-                }
+                journal.setLocation(glbInstMap[inst->getMatchedLUTID()], loc);
             }
-            else
+#ifdef HPWL_COST
+            const Instance *movedInsts[2] = {inst, nullptr};
+            int numMoved = 1;
+            if (inst->getMatchedLUTID() != -1)
             {
-                originLoc = inst->getLocation();
-                inst->setLocation(loc);
-                if (inst->getMatchedLUTID() != -1)
-                {
-                    Instance *matchedInst = glbInstMap[inst->getMatchedLUTID()];
-                    matchedInst->setLocation(loc);
-                }
+                movedInsts[numMoved++] = glbInstMap[inst->getMatchedLUTID()];
             }
-            int afterNetWL = getRelatedWirelength(isBaseline, instRelatedNetId);
+            int costNew = cost + glbNetBBox.evalMove(movedInsts, numMoved, originLoc, loc);
+#else
+            int afterNetWL = evalFlatWirelength(glbFlatNetlist, isBaseline, netsBegin, netsEnd);
             int costNew = cost - beforeNetWL + afterNetWL;
+#endif
             // costNew = getHPWL(isBaseline);
             // deta = new_cost - cost
             int deta = costNew - cost;
@@ -1125,42 +890,60 @@ int arbsa(bool isBaseline, std::string nodesFile){
                 std::cout<<"DEBUG-deta:"<<deta<<std::endl;
             #endif
 
-            //计算pin密度变化 tryUpdateAndCheck
-            //改变tile
-            changeTile(isBaseline, originLoc, loc, inst);
-
             // 生成一个 0 到 1 之间的随机浮点数
             double randomValue = generate_random_double(0.0, 1.0);
             double eDetaT = exp(-deta/T);
+            bool accept = deta < 0 || randomValue < eDetaT;
+            if (accept)
+            {
+                //改变tile之后才能计算pin密度变化，被Metropolis拒绝的移动不需要改tile
+                journal.changeTile(inst, originLoc, loc);
+                accept = tryUpdatePinDensity(originLoc, loc);
+            }
             // if deta < 0 更新这个操作到布局中，更新fitness列表
-            if((deta < 0 || randomValue < eDetaT) && tryUpdatePinDensity(originLoc, loc)){
+            if (accept)
+            {
+                journal.commit();
+                bestTracker.recordMove(inst, matchedInst, originLoc, loc);
                 // 间隔次数多了再更新这两
                 // calculRelatedRangeMap(isBaseline, rangeActualMap, instRelatedNetId);
                 // calculRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, instRelatedNetId);
+                commitFlatWirelength(glbFlatNetlist, isBaseline, netsBegin, netsEnd);
+#ifdef HPWL_COST
+                glbNetBBox.commitMove();
+#endif
+                glbMoveGen.instMoved(inst);
+                if (inst->getMatchedLUTID() != -1)
+                {
+                    glbMoveGen.instMoved(glbInstMap[inst->getMatchedLUTID()]);
+                }
                 cost = costNew;
+                if (bestTracker.update(cost))
+                {
+#ifndef BIGNET_APPROX
+                    bestBigNetCost = bigNetCostPre;
+#endif
+                }
                 sigmaVec.emplace_back(costNew);
                 // sortedFitness(fitnessVec);
             }
             else{
                 //复原
-                changeTile(isBaseline, loc, originLoc, inst);
-                if(isBaseline){
-                    inst->setBaseLocation(originLoc);
-                } else{
-                    inst->setLocation(originLoc);
-                }
+                journal.rollback();
             }
             // counterNet 计数+1
             counterNet += 1;
             if (counterNet % 100 == 0)
             {
-                calculRelatedRangeMap(isBaseline, rangeActualMap, instRelatedNetId);
-                calculRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, instRelatedNetId);
+                for (const int *n = netsBegin; n != netsEnd; ++n)
+                {
+                    netFitness.updateNet(*n);
+                }
             }
             // 当计数等于一个限制时，更新rangeActual 到 rangeDesired
             if (counterNet == counterNetLimit)
             {
-                rangeDesiredMap = rangeActualMap;
+                netFitness.promoteActual();
                 counterNet = 0;
             }
         }
@@ -1189,11 +972,72 @@ int arbsa(bool isBaseline, std::string nodesFile){
         T = alpha * T;
         // Iter = 0
         Iter = 0;
-        // 排序fitness列表
-        sortedFitness(fitnessVec);
     }
     //记录截止次数
     writeJsonFile(filename, jsonData);
+    // 回到历史最优布局，按相反顺序撤销最优之后接受的移动
+    if (!bestTracker.isAtBest())
+    {
+        std::cout << "[INFO] restore best cost " << bestTracker.getBestCost() << " (current " << cost << "), undo " << bestTracker.getNumMoves() << " moves" << std::endl;
+        Instance *inst;
+        std::tuple<int, int, int> originLoc, loc;
+        while (bestTracker.popMove(inst, originLoc, loc))
+        {
+            journal.begin(isBaseline);
+            journal.setLocation(inst, originLoc);
+            if (inst->getMatchedLUTID() != -1)
+            {
+                journal.setLocation(glbInstMap[inst->getMatchedLUTID()], originLoc);
+            }
+            journal.changeTile(inst, loc, originLoc);
+            journal.commit();
+            updatePinDensity(loc);
+            updatePinDensity(originLoc);
+        }
+        // 日志超过上限时更早的移动压缩在快照里
+        std::vector<BestTracker::SnapshotEntry> moved;
+        writeBackSnapshot(isBaseline, false, bestTracker, moved);
+        for (auto &it : moved)
+        {
+            std::tuple<int, int, int> bestLoc = isBaseline ? it.first->getBaseLocation() : it.first->getLocation();
+            glbTilePinCounter.moveInstance(isBaseline, it.first, it.second, bestLoc);
+            updatePinDensity(it.second);
+            updatePinDensity(bestLoc);
+        }
+        if (!moved.empty())
+        {
+            std::cout << "[INFO] write back " << moved.size() << " insts from snapshot" << std::endl;
+        }
+        cost = bestTracker.getBestCost();
+        invalidateWirelengthCache(glbNetMap);
+#ifdef HPWL_COST
+        glbNetBBox.build(glbNetMap, isBaseline);
+#endif
+        // 重新计算写回后的cost，应与最优cost一致（bigNet部分按最优时的值计）
+#ifdef HPWL_COST
+        int restoredCost = glbNetBBox.getTotalHPWL();
+#ifndef BIGNET_APPROX
+        restoredCost += bestBigNetCost - bigNetCostInit;
+#endif
+#else
+        int restoredCost = getWirelength(isBaseline);
+#ifndef BIGNET_APPROX
+        restoredCost += bestBigNetCost - getRelatedWirelength(isBaseline, glbBigNet);
+#endif
+#endif
+        if (restoredCost != bestTracker.getBestCost())
+        {
+            std::cout << "Error: restored cost " << restoredCost << " differs from best cost " << bestTracker.getBestCost() << std::endl;
+        }
+    }
+    glbFreeSiteIndex.clear();
+    glbFlatNetlist.clear();
+    glbMoveGen.clear();
+#ifdef BIGNET_APPROX
+    //恢复精确的FLUTE，缓存中的bigNet线长是估计值
+    rsmt.setHighDegreeModel(HD_FLUTE, HD_APPROX_D);
+    invalidateWirelengthCache(glbNetMap);
+#endif
     
     // 记录结束时间
     auto end = std::chrono::high_resolution_clock::now();
@@ -1203,6 +1047,7 @@ int arbsa(bool isBaseline, std::string nodesFile){
 
     // 输出运行时间（单位为秒）
     std::cout << "runtime: " << duration.count() << " s" << std::endl;
+    glbSteinerCache.report();
 #ifdef EXTERITER
     std::cout << "runtime/exterIterLimit:" << duration.count() / (exterIterLimit) <<" runtime/iter:" << duration.count() / ((exterIterLimit)*2000)<< std::endl;
 #endif
@@ -1227,24 +1072,16 @@ int newArbsa(bool isBaseline, bool isSeqPack)
 
     // 初始布局
 
-    // 懒加载，算到再加进去，用空间换时间。key: instId  value: instRelatedNetId
-    std::map<int, std::set<int>> instRelatedNetIdMap;
-
-    // 构造 fitness 优先级列表 初始化 rangeDesired
-    std::vector<std::pair<int, float>> fitnessVec; // 第一个是netId，第二个是适应度fitness, 适应度越小表明越需要移动。后续会按照fitness升序排列
-    std::map<int, int> rangeDesiredMap;            // 第一个是netId，第二个是外框矩形的平均跨度，即半周线长的一半
-    calculrangeMap(isBaseline, rangeDesiredMap);
-    for (auto it : glbPackNetMap)
-    {
-        Net *net = it.second;
-        // 构造fitnessVec
-        fitnessVec.emplace_back(std::make_pair(net->getId(), 0));
-    }
-    std::map<int, int> rangeActualMap(rangeDesiredMap); // 第一个是netId，第二个是当前实际的外框矩形的平均跨度，即半周线长的一半
-
-    // 计算 fitness 并 排序
-    calculFitness(fitnessVec, rangeDesiredMap, rangeActualMap);
-    sortedFitness(fitnessVec);
+    glbFlatNetlist.build(glbNetMap);
+    glbFlatPackNetlist.build(glbPackNetMap);
+    glbMoveGen.build(glbFlatPackNetlist, isBaseline);
+    // 移动相关的net下标（glbFlatPackNetlist），每次移动重复使用；粗化时不区分bigNet
+    std::vector<int> relatedNets;
+    std::vector<char> isBigNet(glbFlatPackNetlist.getNumNets(), 0);
+    // 构造 fitness 优先级结构 初始化 rangeDesired
+    NetFitness netFitness;
+    netFitness.build(glbFlatPackNetlist, isBaseline);
+    BestTracker bestTracker;
 
     // 初始化迭代次数Iter、初始化温度T
     int Iter = 0;
@@ -1256,7 +1093,15 @@ int newArbsa(bool isBaseline, bool isSeqPack)
     // 计算初始cost
     int cost = 0, costNew = 0;
     // int cost1 = getWirelength(isBaseline);
+    invalidateWirelengthCache(glbPackNetMap);
+    chip.rebuildTileOccupancy();
+#ifdef HPWL_COST
+    glbNetBBox.build(glbPackNetMap, isBaseline);
+    cost = glbNetBBox.getTotalHPWL();
+#else
     cost = getPackWirelength(isBaseline); // wbx 计算pack后的线长
+#endif
+    glbFreeSiteIndex.build(isBaseline);
     // cost = getHPWL(isBaseline);
     // 自适应参数
     int counterNet = 0;
@@ -1269,46 +1114,33 @@ int newArbsa(bool isBaseline, bool isSeqPack)
     for (int i = 0; i < 50; i++)
     {
         // 计算50次步骤取方差
-        int netId = selectNetId(fitnessVec);
-        Net *net = glbPackNetMap[netId]; // 修改为新的Netmap
-        Instance *inst = selectInst(net);
+        int netIdx = selectNetIdx(netFitness, glbFlatPackNetlist);
+        Instance *inst = glbMoveGen.selectInst(netIdx, get_random_engine());
         if (inst == nullptr)
         {
             // 没找到可移动的inst，跳过后续部分
             continue;
         }
         int centerX, centerY;
-        std::tie(centerX, centerY) = getNetCenter(isBaseline, net);
+        std::tie(centerX, centerY) = glbMoveGen.getNetCenter(netIdx);
         int x, y, z;
-        std::tie(x, y, z) = findPackSuitableLoc(isBaseline, centerX, centerY, rangeDesiredMap[netId], inst, isSeqPack);
+        std::tie(x, y, z) = findPackSuitableLoc(isBaseline, centerX, centerY, netFitness.getDesiredRange(netIdx), inst, isSeqPack);
         if (z == -1)
         {
             // 没找到合适位置
             continue;
         }
         // 找到这个inst附近的net
-        std::set<int> instRelatedNetId;
-        // 访问inputpin
-        for (auto &pin : inst->getInpins())
-        {
-            int netId = pin->getNetID();
-            //-1表示未连接
-            if (netId != -1)
-                instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-        }
-        // 访问outputpin
-        for (auto &pin : inst->getOutpins())
-        {
-            int netId = pin->getNetID();
-            //-1表示未连接
-            if (netId != -1)
-                instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-        }
+        collectRelatedNets(glbFlatPackNetlist, isBigNet, inst, nullptr, relatedNets);
+        const int *netsBegin = relatedNets.data();
+        const int *netsEnd = netsBegin + relatedNets.size();
         // 计算移动后的newCost
         std::tuple<int, int, int> loc = std::make_tuple(x, y, z);
         std::tuple<int, int, int> originLoc;
         // 保存更新前的部分net
-        int beforeNetWL = getPackRelatedWirelength(isBaseline, instRelatedNetId);
+#ifndef HPWL_COST
+        int beforeNetWL = getCachedFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
+#endif
         if (isBaseline)
         {
             originLoc = inst->getBaseLocation();
@@ -1319,8 +1151,12 @@ int newArbsa(bool isBaseline, bool isSeqPack)
             originLoc = inst->getLocation();
             inst->setLocation(loc);
         }
-        int afterNetWL = getPackRelatedWirelength(isBaseline, instRelatedNetId);
+#ifdef HPWL_COST
+        int costNew = cost + glbNetBBox.evalMove(&inst, 1, originLoc, loc);
+#else
+        int afterNetWL = evalFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
         int costNew = cost - beforeNetWL + afterNetWL;
+#endif
         if (costNew < cost)
         {
             sigmaVecInit.emplace_back(costNew);
@@ -1351,6 +1187,7 @@ int newArbsa(bool isBaseline, bool isSeqPack)
     int epsilon = 1; // 设置收敛阈值
     int exterIter = 0;
     int costPre = cost;
+    bestTracker.begin(cost);
     // 外层循环 温度大于阈值， 更新一次fitness优先级列表
     while (T > threashhold)
     {
@@ -1388,13 +1225,12 @@ int newArbsa(bool isBaseline, bool isSeqPack)
             // std::cout<<"[INFO] T:"<< std::scientific << std::setprecision(3) <<T <<" iter:"<<std::setw(4)<<Iter<<" alpha:"<<std::fixed<<std::setprecision(2)<<alpha<<" cost:"<<std::setw(7)<<cost<<std::endl;
             Iter++;
             // 根据fitness列表选择一个net
-            int netId = selectNetId(fitnessVec);
+            int netIdx = selectNetIdx(netFitness, glbFlatPackNetlist);
 #ifdef DEBUG
-            std::cout << "DEBUG-netId:" << netId << std::endl;
+            std::cout << "DEBUG-netIdx:" << netIdx << std::endl;
 #endif
-            Net *net = glbPackNetMap[netId];
             // 随机选择net中的一个inst
-            Instance *inst = selectInst(net);
+            Instance *inst = glbMoveGen.selectInst(netIdx, get_random_engine());
             if (inst == nullptr)
             {
                 // 没找到可移动的inst，跳过后续部分
@@ -1406,89 +1242,32 @@ int newArbsa(bool isBaseline, bool isSeqPack)
 #endif
             // 确定net的中心
             int centerX, centerY;
-            std::tie(centerX, centerY) = getNetCenter(isBaseline, net);
+            std::tie(centerX, centerY) = glbMoveGen.getNetCenter(netIdx);
             // 在 rangeDesired 范围内选取一个位置去放置这个inst
             int x, y, z;
-            std::tie(x, y, z) = findPackSuitableLoc(isBaseline, centerX, centerY, rangeDesiredMap[netId], inst, isSeqPack);
+            std::tie(x, y, z) = findPackSuitableLoc(isBaseline, centerX, centerY, netFitness.getDesiredRange(netIdx), inst, isSeqPack);
             if (z == -1)
             {
                 // 没找到合适位置
                 continue;
             }
-            // 空间换时间
-            // 找到这个inst附近的net
-            std::set<int> instRelatedNetId;
-            int instId = std::stoi(inst->getInstanceName().substr(5)); // inst_xxx 从第5个字符开始截取，转换为整数
-            if (instRelatedNetIdMap.count(instId))
+            // 找到这个inst附近的net，配对的net也加上
+            Instance *matchedInst = nullptr;
+            if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
             {
-                // 找得到
-                instRelatedNetId = instRelatedNetIdMap[instId];
-            }
-            else
-            {
-                // 访问inputpin
-                for (auto &pin : inst->getInpins())
-                {
-                    if (oldNetID2newNetID[pin->getNetID()] == 5925)
-                    {
-                        int a = 0;
-                    }
-                    int netId = pin->getNetID();
-                    //-1表示未连接
-                    if (netId != -1)
-                        instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-                }
-                // 访问outputpin
-                for (auto &pin : inst->getOutpins())
-                {
-                    if (oldNetID2newNetID[pin->getNetID()] == 5925)
-                    {
-                        int a = 0;
-                    }
-
-                    int netId = pin->getNetID();
-                    //-1表示未连接
-                    if (netId != -1)
-                        instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-                }
-                if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
-                {
-                    // 将配对的net也加上
-                    Instance *instMatch = glbInstMap[inst->getMatchedLUTID()];
-                    // 访问inputpin
-                    for (auto &pin : instMatch->getInpins())
-                    {
-                        int netId = pin->getNetID();
-                        if (oldNetID2newNetID[pin->getNetID()] == 5925)
-                        {
-                            int a = 0;
-                        }
-                        //-1表示未连接
-                        if (netId != -1)
-                            instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-                    }
-                    // 访问outputpin
-                    for (auto &pin : instMatch->getOutpins())
-                    {
-                        int netId = pin->getNetID();
-                        if (oldNetID2newNetID[pin->getNetID()] == 5925)
-                        {
-                            int a = 0;
-                        }
-                        //-1表示未连接
-                        if (netId != -1)
-                            instRelatedNetId.insert(oldNetID2newNetID[pin->getNetID()]);
-                    }
-                    instRelatedNetIdMap[inst->getMatchedLUTID()] = instRelatedNetId; // 记录下来。下次这个instId就不需要运算了
-                }
-                instRelatedNetIdMap[instId] = instRelatedNetId; // 记录下来。下次这个instId就不需要运算了
+                matchedInst = glbInstMap[inst->getMatchedLUTID()];
             }
+            collectRelatedNets(glbFlatPackNetlist, isBigNet, inst, matchedInst, relatedNets);
+            const int *netsBegin = relatedNets.data();
+            const int *netsEnd = netsBegin + relatedNets.size();
 
             // 计算移动后的newCost
             std::tuple<int, int, int> loc = std::make_tuple(x, y, z);
             std::tuple<int, int, int> originLoc;
             // 保存更新前的部分net
-            int beforeNetWL = getPackRelatedWirelength(isBaseline, instRelatedNetId);
+#ifndef HPWL_COST
+            int beforeNetWL = getCachedFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
+#endif
             if (isBaseline)
             {
                 originLoc = inst->getBaseLocation();
@@ -1510,8 +1289,12 @@ int newArbsa(bool isBaseline, bool isSeqPack)
                     // matchedInst->setLocation(loc);
                 }
             }
-            int afterNetWL = getPackRelatedWirelength(isBaseline, instRelatedNetId);
+#ifdef HPWL_COST
+            int costNew = cost + glbNetBBox.evalMove(&inst, 1, originLoc, loc);
+#else
+            int afterNetWL = evalFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
             int costNew = cost - beforeNetWL + afterNetWL;
+#endif
             // costNew = getHPWL(isBaseline);
             // deta = new_cost - cost
             int deta = costNew - cost;
@@ -1522,10 +1305,17 @@ int newArbsa(bool isBaseline, bool isSeqPack)
             if (deta < 0)
             {
                 changePackTile(isBaseline, originLoc, loc, inst, isSeqPack);
+                bestTracker.recordMove(inst, nullptr, originLoc, loc);
+                commitFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
+                glbMoveGen.instMoved(inst);
+#ifdef HPWL_COST
+                glbNetBBox.commitMove();
+#endif
                 // 间隔次数多了再更新这两
                 // calculRelatedRangeMap(isBaseline, rangeActualMap, instRelatedNetId);
                 // calculRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, instRelatedNetId);
                 cost = costNew;
+                bestTracker.update(cost);
                 sigmaVec.emplace_back(costNew);
                 // sortedFitness(fitnessVec);
             }
@@ -1541,10 +1331,17 @@ int newArbsa(bool isBaseline, bool isSeqPack)
                 if (randomValue < eDetaT)
                 {
                     changePackTile(isBaseline, originLoc, loc, inst, isSeqPack);
+                    bestTracker.recordMove(inst, nullptr, originLoc, loc);
+                    commitFlatWirelength(glbFlatPackNetlist, isBaseline, netsBegin, netsEnd);
+                    glbMoveGen.instMoved(inst);
+#ifdef HPWL_COST
+                    glbNetBBox.commitMove();
+#endif
                     // 间隔次数多了再更新这两
                     // calculRelatedRangeMap(isBaseline, rangeActualMap, instRelatedNetId);
                     // calculRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, instRelatedNetId);
                     cost = costNew;
+                    bestTracker.update(cost);
                     sigmaVec.emplace_back(costNew);
                 }
                 else
@@ -1573,13 +1370,15 @@ int newArbsa(bool isBaseline, bool isSeqPack)
             counterNet += 1;
             if (counterNet % 100 == 0)
             {
-                calculPackRelatedRangeMap(isBaseline, rangeActualMap, instRelatedNetId);
-                calculPackRelatedFitness(fitnessVec, rangeDesiredMap, rangeActualMap, instRelatedNetId);
+                for (const int *n = netsBegin; n != netsEnd; ++n)
+                {
+                    netFitness.updateNet(*n);
+                }
             }
             // 当计数等于一个限制时，更新rangeActual 到 rangeDesired
             if (counterNet == counterNetLimit)
             {
-                rangeDesiredMap = rangeActualMap;
+                netFitness.promoteActual();
                 counterNet = 0;
             }
         }
@@ -1608,8 +1407,41 @@ int newArbsa(bool isBaseline, bool isSeqPack)
         T = alpha * T;
         // Iter = 0
         Iter = 0;
-        // 排序fitness列表
-        sortedFitness(fitnessVec);
+    }
+
+    // 回到历史最优布局，按相反顺序撤销最优之后接受的移动
+    if (!bestTracker.isAtBest())
+    {
+        std::cout << "[INFO] restore best cost " << bestTracker.getBestCost() << " (current " << cost << "), undo " << bestTracker.getNumMoves() << " moves" << std::endl;
+        Instance *inst;
+        std::tuple<int, int, int> originLoc, loc;
+        while (bestTracker.popMove(inst, originLoc, loc))
+        {
+            if (isBaseline)
+                inst->setBaseLocation(originLoc);
+            else
+                inst->setLocation(originLoc);
+            changePackTile(isBaseline, loc, originLoc, inst, isSeqPack);
+        }
+        // 日志超过上限时更早的移动压缩在快照里
+        std::vector<BestTracker::SnapshotEntry> moved;
+        writeBackSnapshot(isBaseline, isSeqPack, bestTracker, moved);
+        if (!moved.empty())
+        {
+            std::cout << "[INFO] write back " << moved.size() << " insts from snapshot" << std::endl;
+        }
+        cost = bestTracker.getBestCost();
+        invalidateWirelengthCache(glbPackNetMap);
+#ifdef HPWL_COST
+        glbNetBBox.build(glbPackNetMap, isBaseline);
+        int restoredCost = glbNetBBox.getTotalHPWL();
+#else
+        int restoredCost = getPackWirelength(isBaseline);
+#endif
+        if (restoredCost != bestTracker.getBestCost())
+        {
+            std::cout << "Error: restored cost " << restoredCost << " differs from best cost " << bestTracker.getBestCost() << std::endl;
+        }
     }
 
     // 记录结束时间
@@ -1620,7 +1452,12 @@ int newArbsa(bool isBaseline, bool isSeqPack)
 
     // 输出运行时间（单位为秒）
     std::cout << "runtime: " << duration.count() << " s" << std::endl;
+    glbSteinerCache.report();
 
+    glbFreeSiteIndex.clear();
+    glbFlatNetlist.clear();
+    glbFlatPackNetlist.clear();
+    glbMoveGen.clear();
     // 还原最终结果映射
     recoverAllMap(isSeqPack);
 
@@ -1629,311 +1466,55 @@ int newArbsa(bool isBaseline, bool isSeqPack)
 
 bool isPackValid(bool isBaseline, int x, int y, int &z, Instance *inst, bool isSeqPack)
 { // 判断这个位置是否可插入该inst，如果可插入则返回z值
-    bool valid = false;
-    Tile *tile = chip.getTile(x, y);
-    // if(tile == NULL || tile->matchType("PLB") == false){
-    //     return false;
-    // }
-    std::string instType = inst->getModelName();
-    std::string instName = inst->getInstanceName();
-    int instId = std::stoi(inst->getInstanceName().substr(5)); // inst_xxx 从第5个字符开始截取，转换为整数
-    if (instType.substr(0, 3) == "LUT")
+    return isPackValidAt(chip.getTile(x, y)->getOccupancy(isBaseline), z, inst, isSeqPack);
+}
+
+bool isPackValidAt(const TileOccupancy &occ, int &z, Instance *inst, bool isSeqPack)
+{
+    const std::string &instType = inst->getModelName();
+    if (instType.compare(0, 3, "LUT") == 0)
     {
-        std::vector<int> hasDRAM(2, 0); //  1 表示有DRAM
-        // 先判断是否有DRAM
-        slotArr dramSlotArr = *(tile->getInstanceByType("DRAM"));
-        slotArr lutSlotArr = *(tile->getInstanceByType("LUT"));
-        int lutBegin = 0, lutEnd = 0;
-        for (int idx = 0; idx < (int)dramSlotArr.size(); idx++)
-        {
-            Slot *slot = dramSlotArr[idx];
-            if (slot == nullptr)
-            {
-                continue;
-            }
-            std::list<int> instances;
-            if (isBaseline)
-            {
-                instances = slot->getBaselineInstances();
-            }
-            else
-            {
-                instances = slot->getOptimizedInstances();
-            }
-            if (instances.empty())
-            {
-                continue;
-            }
-            // DRAM at slot0 blocks lut slot 0~3
-            // DRAM at slot1 blocks lut slot 4~7
-            hasDRAM[idx] = 1;
-        }
-        if (hasDRAM[0] && hasDRAM[1])
+        int lutBegin, lutEnd;
+        if (!getLutRange(occ, lutBegin, lutEnd))
         {
             // 两个都是DRAM，不可放置
             return false;
         }
-        // 0-3不可放
-        else if (hasDRAM[0])
-        {
-            lutBegin = 4;
-            lutEnd = 8;
-        }
-        // 4-7不可放
-        else if (hasDRAM[1])
-        {
-            lutBegin = 0;
-            lutEnd = 4;
-        }
-        // 都可以放
-        else
-        {
-            lutBegin = 0;
-            lutEnd = 8;
-        }
         // 新加的 cjq 1104
-        if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
+        if (inst->getMatchedLUTID() != -1)
         {
-            for (int idx = lutBegin; idx < lutEnd; idx++)
-            {
-                Slot *slot = lutSlotArr[idx];
-                if (slot == nullptr)
-                {
-                    continue;
-                }
-                std::list<int> instances;
-                if (isBaseline)
-                {
-                    instances = slot->getBaselineInstances();
-                }
-                else
-                {
-                    instances = slot->getOptimizedInstances();
-                }
-                if (instances.size() == 0)
-                {
-                    // 找到整个位置都是空的
-                    z = idx;
-                    return true;
-                }
-            }
-            return false;
+            return findEmptyLutSlot(occ, lutBegin, lutEnd, z);
         }
-        std::vector<std::pair<int, int>> record; // 记录每个引脚小于6的 lut  [idx, pinNum]
-        for (int idx = lutBegin; idx < lutEnd; idx++)
+        return findLutSlot(occ, inst, lutBegin, lutEnd, true, z);
+    }
+    if (instType != "SEQ")
+    {
+        return false;
+    }
+    if (isSeqPack)
+    {
+        // 现在的SEQ为一个bank组，所以返回的应该是bank的位置，0或1，只需要检查是否有空余 bank 就行
+        if ((occ.seqUsed & 0x00FF) == 0)
         {
-            Slot *slot = lutSlotArr[idx];
-            if (slot == nullptr)
-            {
-                continue;
-            }
-            std::list<int> instances;
-            if (isBaseline)
-            {
-                instances = slot->getBaselineInstances();
-            }
-            else
-            {
-                instances = slot->getOptimizedInstances();
-            }
-
-            if (instances.size() == 1)
-            {
-                Instance *instanceTmp = glbInstMap[instances.front()];
-                int inttmp = instanceTmp->getMapInstID().size();
-
-                if (inttmp == 2)
-                {
-                    int a = 0;
-                    continue;
-                }                
-
-                // 大于1个lut，不可放入了
-                instances.push_back(instId); // 添加当前instId
-                std::set<int> totalInputs;
-                for (auto instID : instances)
-                {
-                    Instance *instPtr = glbInstMap.find(instID)->second;
-                    std::vector<Pin *> inpins = instPtr->getInpins();
-                    for (auto pin : inpins)
-                    {
-                        if (pin->getNetID() != -1)
-                        {
-                            totalInputs.insert(pin->getNetID());
-                        }
-                    }
-                }
-                if (totalInputs.size() <= 6)
-                {
-                    // 符合条件 记录
-                    record.emplace_back(std::make_pair(idx, totalInputs.size()));
-                }
-            }
-            if (instances.size() == 0)
-            {
-                // 大于1个lut，不可放入了
-                instances.push_back(instId); // 添加当前instId
-                std::set<int> totalInputs;
-                for (auto instID : instances)
-                {
-                    Instance *instPtr = glbInstMap.find(instID)->second;
-                    std::vector<Pin *> inpins = instPtr->getInpins();
-                    for (auto pin : inpins)
-                    {
-                        if (pin->getNetID() != -1)
-                        {
-                            totalInputs.insert(pin->getNetID());
-                        }
-                    }
-                }
-                if (totalInputs.size() <= 6)
-                {
-                    // 符合条件 记录
-                    record.emplace_back(std::make_pair(idx, totalInputs.size()));
-                }
-            }
+            z = 0;
+            return true;
         }
-        if (record.size() != 0)
+        if ((occ.seqUsed & 0xFF00) == 0)
         {
-            // 按第二个元素降序排序
-            std::sort(record.begin(), record.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b)
-                      {
-                          return a.second > b.second; // 使用 > 实现降序
-                      });
-            if (z > 8)
-            {
-                int a = 0;
-            }
-
-            z = record[0].first;
+            z = 1;
             return true;
         }
+        return false;
     }
-    if (isSeqPack)
-    {
-        if (inst->getModelName() == "SEQ")
-        { // LUT可以不用改，SEQ需要大改，现在的SEQ为一个bank组，所以返回的应该是bank的位置，0或1，只需要检查是否有空余 bank 就行
-            slotArr seqSlotArr = *(tile->getInstanceByType("SEQ"));
-            bool zeroFlag = true;
-            bool oneFlag = true;
-            for (int i = 0; i < 15; i++)
-            {
-                Slot *slot = seqSlotArr[i];
-                if (slot->getOptimizedInstances().size() != 0 && i < 8)
-                {
-                    zeroFlag = false;
-                }
-                if (slot->getOptimizedInstances().size() != 0 && i >= 8)
-                {
-                    oneFlag = false;
-                }
-            }
-            if (zeroFlag)
-            {
-                z = 0;
-                valid = true;
-            }
-            if (!zeroFlag && oneFlag)
-            {
-                z = 1;
-                valid = true;
-            }
-            if (!zeroFlag && !oneFlag)
-            {
-                valid = false;
-            }
-        }
-    }
-    else
+    for (int bank = 0; bank < 2; bank++)
     {
-        if (inst->getModelName() == "SEQ")
+        // SEQ只要返回一个空位子即可
+        if (seqBankAccepts(occ, bank, inst) && findEmptySeqSlot(occ, bank, z))
         {
-            slotArr seqSlotArr = *(tile->getInstanceByType("SEQ"));
-            for (int bank = 0; bank < 2; bank++)
-            {
-                // bank0 0-8   bank1 8-16
-                int start = bank * 8;
-                int end = (bank + 1) * 8;
-                std::set<int> instIdSet;
-                instIdSet.insert(instId); // 添加当前Id
-                for (int i = start; i < end; i++)
-                {
-                    Slot *slot = seqSlotArr[i];
-                    std::list<int> instList;
-                    if (isBaseline)
-                        instList = slot->getBaselineInstances();
-                    else
-                        instList = slot->getOptimizedInstances();
-                    for (int id : instList)
-                    {
-                        instIdSet.insert(id);
-                    }
-                }
-                // 判断每个inst的引脚
-                std::set<int> clkNets; // 不超过1
-                std::set<int> ceNets;  // 不超过2
-                std::set<int> srNets;  // 不超过1
-                for (int i : instIdSet)
-                {
-                    Instance *instPtr = glbInstMap[i];
-                    int numInpins = instPtr->getNumInpins();
-                    for (int i = 0; i < numInpins; i++)
-                    {
-                        // 只判断input是否是这几个量
-                        Pin *pin = instPtr->getInpin(i);
-                        int netID = pin->getNetID();
-                        if (netID >= 0)
-                        {
-                            PinProp prop = pin->getProp();
-                            if (prop == PIN_PROP_CE)
-                            {
-                                ceNets.insert(netID);
-                            }
-                            else if (prop == PIN_PROP_CLOCK)
-                            {
-                                clkNets.insert(netID);
-                            }
-                            else if (prop == PIN_PROP_RESET)
-                            {
-                                srNets.insert(netID);
-                            }
-                        }
-                    }
-                }
-
-                int numClk = clkNets.size();
-                int numReset = srNets.size();
-                int numCe = ceNets.size();
-
-                if (numClk > MAX_TILE_CLOCK_PER_PLB_BANK || numCe > MAX_TILE_CE_PER_PLB_BANK || numReset > MAX_TILE_RESET_PER_PLB_BANK)
-                {
-                    // 该bank放入该inst时违反约束
-                    valid = false;
-                }
-                else
-                {
-                    // SEQ只要返回一个空位子即可
-                    // slotArr seqSlotArr = *(tile->getInstanceByType("SEQ"));
-                    for (int i = start; i < end; i++)
-                    {
-                        Slot *slot = seqSlotArr[i];
-                        std::list<int> listTmp;
-                        if (isBaseline)
-                            listTmp = slot->getBaselineInstances();
-                        else
-                            listTmp = slot->getOptimizedInstances();
-                        if (listTmp.size() == 0)
-                        {
-                            z = i;
-                            return true;
-                        }
-                    }
-                }
-            }
+            return true;
         }
     }
-
-    return valid;
+    return false;
 }
 
 std::tuple<int, int, int> findPackSuitableLoc(bool isBaseline, int x, int y, int rangeDesired, Instance *inst, bool isSeqPack)
@@ -1953,6 +1534,12 @@ std::tuple<int, int, int> findPackSuitableLoc(bool isBaseline, int x, int y, int
     if (yr > numRow)
         yr = numRow;
 
+    std::tuple<int, int, int> sampled;
+    if (glbFreeSiteIndex.isBuilt() && sampleFreeSite(isBaseline, xl, xr, yl, yr, inst, true, isSeqPack, sampled))
+    {
+        return sampled;
+    }
+
     // 生成矩形框内的所有坐标
     std::vector<std::pair<int, int>> coordinates;
     for (int x = xl; x <= xr; ++x)
@@ -2009,282 +1596,66 @@ std::tuple<int, int, int> findPackSuitableLoc(bool isBaseline, int x, int y, int
     return {xx, yy, zz};
 }
 
-// 修改slot队列
-int changePackTile(bool isBaseline, std::tuple<int, int, int> originLoc, std::tuple<int, int, int> loc, Instance *inst, bool isSeqPack)
+// 从原来的tile插槽中删除inst
+int removePackTile(bool isBaseline, std::tuple<int, int, int> originLoc, Instance *inst)
 {
-    int xCur, yCur, zCur, xGoal, yGoal, zGoal;
+    int xCur, yCur, zCur;
     std::tie(xCur, yCur, zCur) = originLoc;
-    std::tie(xGoal, yGoal, zGoal) = loc;
     Tile *tileCur = chip.getTile(xCur, yCur);
-    Tile *tileGoal = chip.getTile(xGoal, yGoal);
-    int instId = std::stoi(inst->getInstanceName().substr(5)); // inst_xxx 从第5个字符开始截取，转换为整数
-    // 删除旧的tile插槽中的inst
-    slotArr *slotArrCur = tileCur->getInstanceByType(inst->getModelName().substr(0, 3)); // LUT or SEQ
-    Slot *slot = slotArrCur->at(zCur);
-    if (inst->getMatchedLUTID() != -1 && (inst->getModelName()).substr(0, 3) == "LUT")
+    int instId = inst->getInstID();
+    const std::string &modelType = inst->getModelName();
+    if (modelType.compare(0, 3, "LUT") == 0)
     {
-        if (isBaseline)
-            slot->clearBaselineInstances();
+        if (inst->getMatchedLUTID() != -1)
+            tileCur->clearSlot(zCur, modelType, isBaseline);
         else
-            slot->clearOptimizedInstances();
-        // 添加到新的tile
-        tileGoal->addInstance(instId, zGoal, inst->getModelName(), isBaseline);
-        // tileGoal->addInstance(inst->getMatchedLUTID(), zGoal, inst->getModelName(), isBaseline);
+            tileCur->removeInstanceAt(instId, zCur, modelType, isBaseline);
     }
-    if (inst->getMatchedLUTID() == -1 && (inst->getModelName()).substr(0, 3) == "LUT")
+    if (modelType.compare(0, 3, "SEQ") == 0)
     {
-        if (isBaseline)
-        {
-            std::list<int> &instances = slot->getBaselineInstances();
-            for (int instIdTmp : instances)
-            {
-                if (instId == instIdTmp)
-                {
-                    instances.remove(instIdTmp);
-                    break;
-                }
-            }
-        }
-        else
-        {
-            std::list<int> &instances = slot->getOptimizedInstancesRef();
-            for (int instIdTmp : instances)
-            {
-                if (instId == instIdTmp)
-                {
-                    instances.remove(instIdTmp);
-                    break;
-                }
-            }
-        }
-        // 在新的插槽中插入
-        tileGoal->addInstance(instId, zGoal, inst->getModelName(), isBaseline);
+        tileCur->removeInstanceAt(instId, zCur, modelType, isBaseline);
     }
-
-    if ((inst->getModelName()).substr(0, 3) == "SEQ")
-    {
-        if (isSeqPack)
-        {
-            if (isBaseline)
-            {
-                std::list<int> &instances = slot->getBaselineInstances();
-                for (int instIdTmp : instances)
-                {
-                    if (instId == instIdTmp)
-                    {
-                        instances.remove(instIdTmp);
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                std::list<int> &instances = slot->getOptimizedInstancesRef();
-                for (int instIdTmp : instances)
-                {
-                    if (instId == instIdTmp)
-                    {
-                        instances.remove(instIdTmp);
-                        break;
-                    }
-                }
-            }
-            // 在新的插槽中插入
-            if (zGoal == 0)
-            {
-                for (size_t i = 0; i < inst->getMapInstID().size(); i++)
-                {
-                    tileGoal->addInstance(inst->getMapInstID()[i], i, inst->getModelName(), isBaseline);
-                }
-            }
-            if (zGoal == 1)
-            {
-                for (size_t i = 0; i < inst->getMapInstID().size(); i++)
-                {
-                    tileGoal->addInstance(inst->getMapInstID()[i], i + 8, inst->getModelName(), isBaseline);
-                }
-            }
-        }
-        else
-        {
-            if (isBaseline)
-            {
-                std::list<int> &instances = slot->getBaselineInstances();
-                for (int instIdTmp : instances)
-                {
-                    if (instId == instIdTmp)
-                    {
-                        instances.remove(instIdTmp);
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                std::list<int> &instances = slot->getOptimizedInstancesRef();
-                for (int instIdTmp : instances)
-                {
-                    if (instId == instIdTmp)
-                    {
-                        instances.remove(instIdTmp);
-                        break;
-                    }
-                }
-            }
-            // 在新的插槽中插入
-            tileGoal->addInstance(instId, zGoal, inst->getModelName(), isBaseline);
-        }
-    }
-
     return 0;
 }
 
-// 优化 只计算相关的fitness
-int calculPackRelatedFitness(std::vector<std::pair<int, float>> &fitnessVec, std::map<int, int> &rangeDesiredMap, std::map<int, int> &rangeActualMap, const std::set<int> &instRelatedNetId)
+// 把inst插入新的tile插槽
+int addPackTile(bool isBaseline, std::tuple<int, int, int> loc, Instance *inst, bool isSeqPack)
 {
-    // 计算fitness
-    int n = fitnessVec.size();
-    for (auto netId : instRelatedNetId)
+    int xGoal, yGoal, zGoal;
+    std::tie(xGoal, yGoal, zGoal) = loc;
+    Tile *tileGoal = chip.getTile(xGoal, yGoal);
+    int instId = inst->getInstID();
+    const std::string &modelType = inst->getModelName();
+    if (modelType.compare(0, 3, "LUT") == 0)
     {
-        if (glbPackNetMap.count(netId) <= 0)
-        {
-            std::cout << "calculPackRelatedFitness can not find this netId:" << netId << std::endl;
-            continue;
-        }
-        int index = -1;
-        // 找到匹配netId的下标
-        for (int i = 0; i < fitnessVec.size(); ++i)
+        tileGoal->addInstance(instId, zGoal, modelType, isBaseline);
+    }
+    if (modelType.compare(0, 3, "SEQ") == 0)
+    {
+        if (isSeqPack)
         {
-            if (fitnessVec[i].first == netId)
+            // zGoal为bank编号，bank0 0-8   bank1 8-16
+            std::vector<int> mapInstIDs = inst->getMapInstID();
+            for (size_t i = 0; i < mapInstIDs.size(); i++)
             {
-                index = i;
-                break;
+                tileGoal->addInstance(mapInstIDs[i], zGoal * 8 + i, modelType, isBaseline);
             }
         }
-        if (index == -1)
-        {
-            std::cout << "can not find this netId: " << netId << ", something may be wrong" << std::endl;
-            exit(1);
-        }
-        int rangeDesired = rangeDesiredMap[netId];
-        int rangeActual = rangeActualMap[netId];
-        float fitness;
-        if (rangeDesired == 0 && rangeActual == 0)
-        {
-            fitness = 1; // 都为0则不考虑移动了，认为为最完美的net
-        }
-        else if (rangeDesired >= rangeActual)
-        {
-            fitness = rangeActual / rangeDesired;
-        }
         else
         {
-            fitness = rangeDesired / rangeActual;
+            tileGoal->addInstance(instId, zGoal, modelType, isBaseline);
         }
-        fitnessVec[index] = std::make_pair(netId, fitness);
     }
     return 0;
 }
 
-// 优化，循环体中只计算相关的
-int calculPackRelatedRangeMap(bool isBaseline, std::map<int, int> &rangeActualMap, const std::set<int> &instRelatedNetId)
+// 修改slot队列
+int changePackTile(bool isBaseline, std::tuple<int, int, int> originLoc, std::tuple<int, int, int> loc, Instance *inst, bool isSeqPack)
 {
-    for (int i : instRelatedNetId)
-    {
-        if (glbNetMap.count(i) <= 0)
-        {
-            std::cout << "calculPackRelatedRangeMap can not find this netId:" << i << std::endl;
-            continue;
-        }
-        Net *net = glbNetMap[i];
-        // 访问net input 引脚
-        Instance *instIn = net->getInpin()->getInstanceOwner();
-        int x, y, z;
-        if (isBaseline)
-        {
-            std::tie(x, y, z) = instIn->getBaseLocation();
-        }
-        else
-        {
-            std::tie(x, y, z) = instIn->getLocation();
-        }
-        int maxX, minX, maxY, minY;
-        maxX = minX = x;
-        maxY = minY = y;
-        // 访问net output 引脚
-        std::list<Pin *> outputPins = net->getOutputPins();
-        for (Pin *pin : outputPins)
-        {
-            Instance *instTmp = pin->getInstanceOwner();
-            if (isBaseline)
-            {
-                std::tie(x, y, z) = instTmp->getBaseLocation();
-            }
-            else
-            {
-                std::tie(x, y, z) = instTmp->getLocation();
-            }
-            if (maxX < x)
-                maxX = x;
-            if (minX > x)
-                minX = x;
-            if (maxY < y)
-                maxY = y;
-            if (minY > y)
-                minY = y;
-        }
-        int netDesired = std::ceil((maxX - minX + maxY - minY) / 2);
-        // int netDesired = std::ceil((maxX-minX+maxY-minY));
-        rangeActualMap[net->getId()] = netDesired;
-    }
-    return 0;
-}
+    removePackTile(isBaseline, originLoc, inst);
+    addPackTile(isBaseline, loc, inst, isSeqPack);
+    glbFreeSiteIndex.updateTile(std::get<0>(originLoc), std::get<1>(originLoc));
+    glbFreeSiteIndex.updateTile(std::get<0>(loc), std::get<1>(loc));
 
-// 计算rangeActulMap
-int calculPackrangeMap(bool isBaseline, std::map<int, int> &rangeActualMap)
-{
-    for (auto iter : glbPackNetMap)
-    {
-        Net *net = iter.second;
-        // 访问net input 引脚
-        Instance *instIn = net->getInpin()->getInstanceOwner();
-        int x, y, z;
-        if (isBaseline)
-        {
-            std::tie(x, y, z) = instIn->getBaseLocation();
-        }
-        else
-        {
-            std::tie(x, y, z) = instIn->getLocation();
-        }
-        int maxX, minX, maxY, minY;
-        maxX = minX = x;
-        maxY = minY = y;
-        // 访问net output 引脚
-        std::list<Pin *> outputPins = net->getOutputPins();
-        for (Pin *pin : outputPins)
-        {
-            Instance *instTmp = pin->getInstanceOwner();
-            if (isBaseline)
-            {
-                std::tie(x, y, z) = instTmp->getBaseLocation();
-            }
-            else
-            {
-                std::tie(x, y, z) = instTmp->getLocation();
-            }
-            if (maxX < x)
-                maxX = x;
-            if (minX > x)
-                minX = x;
-            if (maxY < y)
-                maxY = y;
-            if (minY > y)
-                minY = y;
-        }
-        int netDesired = std::ceil((maxX - minX + maxY - minY) / 2);
-        // int netDesired = std::ceil((maxX-minX+maxY-minY));
-        rangeActualMap[net->getId()] = netDesired;
-    }
     return 0;
-}
\ No newline at end of file
+}
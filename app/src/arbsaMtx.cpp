@@ -5,17 +5,657 @@
 #include <algorithm>
 #include <cmath>
 #include "wirelength.h"
+#include "netlistcsr.h"
+#include "netfitness.h"
+#include "movegen.h"
+#include "steinercache.h"
+#include "tilepin.h"
 #include <random>
 // 计时
 #include <chrono>
 //多线程
 #include <thread>
 #include <mutex>
-std::mutex mtx; // 互斥锁
-bool timeupMtx = false; // 超时标志
-const int maxThreads = 8; // 最大线程数
+#include <condition_variable>
+#include <atomic>
+
+#define INFO  //是否输出每次的迭代信息
+#define TIME_LIMIT_MTX 1180
+
+std::mutex mtx; // 互斥锁，保护跨区域移动的延迟队列
+std::atomic<bool> timeupMtx(false); // 超时标志
+const int maxThreads = 8; // hardware_concurrency 获取失败时使用的线程数
+
+/*
+多线程版本的模拟退火
+1、按时钟区域(5x5)划分芯片，每个区域分配给一个线程，线程只移动自己区域内的inst，目标位置也只在自己区域内，
+   因此tile的slot只会被一个线程修改
+2、inst位置会被其它线程在计算线长时读取，所以对每个net加锁：移动inst时按net下标顺序锁住它所有相关net，
+   读取net线长与中心时持有该net的锁
+3、线程在开始时创建一次，每轮用barrier同步；每个线程有自己的NetFitness（只含驱动inst在自己区域的net），
+   选inst用只读的glbMoveGen，相关net、候选坐标都放在线程自己复用的数组里，移动时不分配内存
+4、目标框落在其它区域的移动放入延迟队列，在每轮结束的同步点串行处理
+5、跨tile连接计数与pin密度会涉及其它区域的tile，由一把锁保护；Metropolis接受的移动改变tile之后在锁内更新，
+   与arbsa一样用tryUpdatePinDensity检查，top pin密度之和超过初始值时复原并拒绝
+6、同步点只汇总cost与接受率并更新温度，没有遍历全部net的串行步骤
+*/
+
+struct MtxRegion
+{
+    int xl, xr, yb, yt;
+};
+
+// 跨区域的移动，放到同步点串行处理
+struct MtxDeferredMove
+{
+    Instance *inst;
+    int netIdx;
+    int rangeDesired;
+};
+
+// 每个线程一轮的统计结果
+struct MtxThreadStat
+{
+    int tried = 0;
+    int accepted = 0;
+    long long deta = 0;
+};
+
+// 每个线程自己的状态，跨轮保留
+struct MtxWorker
+{
+    std::mt19937 rng;
+    NetFitness fitness;
+    std::vector<int> nets;                        // 驱动inst在本线程区域的net下标
+    std::vector<int> relatedNets;                 // 一次移动相关的net下标，升序去重
+    std::vector<std::pair<int, int>> coordinates; // 目标框内的候选坐标
+    int counterNet = 0;
+    MtxThreadStat stat;
+};
+
+// 所有线程到齐之后一起继续，可以重复使用
+class MtxBarrier
+{
+public:
+    explicit MtxBarrier(int count) : count(count) {}
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        unsigned gen = generation;
+        if (++waiting == count)
+        {
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+            return;
+        }
+        cv.wait(lock, [this, gen]() { return gen != generation; });
+    }
+
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    int count;
+    int waiting = 0;
+    unsigned generation = 0;
+};
+
+struct MtxContext
+{
+    bool isBaseline;
+    int numCol;
+    int numRow;
+    int numThreads;
+    const FlatNetlist *flat;
+    std::vector<MtxRegion> regions;
+    std::vector<int> tileRegion;  // x*numRow+y -> 时钟区域下标，-1表示不属于任何区域
+    std::vector<int> regionOwner; // 时钟区域 -> 线程id
+    std::vector<std::mutex> netLocks; // 按net下标
+    std::vector<char> isBigNet;       // 按net下标
+    std::mutex pinLock;               // glbTilePinCounter与glbPinDensity
+    std::vector<MtxDeferredMove> deferred;
+
+    // 每轮由主线程设置
+    float T = 0;
+    int InnerIter = 0;
+    bool stop = false;
+
+    int getTileRegion(int x, int y) const { return tileRegion[x * numRow + y]; }
+    int getOwner(int x, int y) const
+    {
+        int r = getTileRegion(x, y);
+        return r == -1 ? -1 : regionOwner[r];
+    }
+};
+
+static std::tuple<int, int, int> getInstLoc(bool isBaseline, Instance *inst)
+{
+    return isBaseline ? inst->getBaseLocation() : inst->getLocation();
+}
+
+static void setInstLoc(bool isBaseline, Instance *inst, const std::tuple<int, int, int> &loc)
+{
+    if (isBaseline)
+        inst->setBaseLocation(loc);
+    else
+        inst->setLocation(loc);
+}
+
+static Instance *getMatchedInst(Instance *inst)
+{
+    if (inst->getMatchedLUTID() == -1)
+        return nullptr;
+    return glbInstMap.at(inst->getMatchedLUTID());
+}
+
+// inst及其配对LUT相关的net下标（不含bigNet），升序去重，结果放在relatedNets中
+static void collectRelatedNets(const MtxContext &ctx, Instance *inst, std::vector<int> &relatedNets)
+{
+    relatedNets.clear();
+    Instance *insts[2] = {inst, getMatchedInst(inst)};
+    for (Instance *it : insts)
+    {
+        if (it == nullptr)
+            continue;
+        int instIdx = ctx.flat->getInstIndex(it);
+        if (instIdx == -1)
+            continue;
+        for (const int *n = ctx.flat->getInstNetsBegin(instIdx); n != ctx.flat->getInstNetsEnd(instIdx); ++n)
+        {
+            if (!ctx.isBigNet[*n])
+                relatedNets.push_back(*n);
+        }
+    }
+    if (insts[1] != nullptr)
+    {
+        std::sort(relatedNets.begin(), relatedNets.end());
+        relatedNets.erase(std::unique(relatedNets.begin(), relatedNets.end()), relatedNets.end());
+    }
+}
+
+// 按net下标升序加锁，避免死锁
+static void lockNets(MtxContext &ctx, const std::vector<int> &nets)
+{
+    for (int n : nets)
+    {
+        ctx.netLocks[n].lock();
+    }
+}
+
+static void unlockNets(MtxContext &ctx, const std::vector<int> &nets)
+{
+    for (auto it = nets.rbegin(); it != nets.rend(); ++it)
+    {
+        ctx.netLocks[*it].unlock();
+    }
+}
+
+// 在[xl,xr]x[yl,yr]内随机找一个可放置的位置，使用线程自己的随机数与候选数组
+static std::tuple<int, int, int> findSuitableLocInWindow(bool isBaseline, int xl, int xr, int yl, int yr, Instance *inst, std::mt19937 &rng,
+                                                         std::vector<std::pair<int, int>> &coordinates)
+{
+    coordinates.clear();
+    for (int x = xl; x <= xr; ++x)
+    {
+        for (int y = yl; y <= yr; ++y)
+        {
+            if (isPLB[x][y])
+            {
+                coordinates.emplace_back(x, y);
+            }
+        }
+    }
+    int xx = -1, yy = -1, zz = -1;
+    int xCur, yCur, zCur;
+    std::tie(xCur, yCur, zCur) = getInstLoc(isBaseline, inst);
+    while (!coordinates.empty())
+    {
+        std::uniform_int_distribution<int> dist(0, coordinates.size() - 1);
+        int randomIndex = dist(rng);
+        xx = coordinates[randomIndex].first;
+        yy = coordinates[randomIndex].second;
+        if ((xCur != xx || yCur != yy) && isValid(isBaseline, xx, yy, zz, inst))
+        {
+            break;
+        }
+        zz = -1;
+        // 移除不符合规则的坐标
+        coordinates[randomIndex] = coordinates.back();
+        coordinates.pop_back();
+    }
+    return std::make_tuple(xx, yy, zz);
+}
+
+// inst与配对的LUT一起更新跨tile连接计数
+static void moveMtxTilePins(bool isBaseline, Instance *inst, Instance *matchedInst, const std::tuple<int, int, int> &originLoc,
+                            const std::tuple<int, int, int> &loc)
+{
+    glbTilePinCounter.moveInstance(isBaseline, inst, originLoc, loc);
+    if (matchedInst != nullptr)
+        glbTilePinCounter.moveInstance(isBaseline, matchedInst, originLoc, loc);
+}
+
+// tile已经改变之后调用，更新pin密度，超过约束时复原连接计数并返回false
+static bool tryMtxPinDensity(MtxContext &ctx, Instance *inst, Instance *matchedInst, const std::tuple<int, int, int> &originLoc,
+                             const std::tuple<int, int, int> &loc)
+{
+    std::lock_guard<std::mutex> lock(ctx.pinLock);
+    moveMtxTilePins(ctx.isBaseline, inst, matchedInst, originLoc, loc);
+    if (tryUpdatePinDensity(originLoc, loc))
+        return true;
+    moveMtxTilePins(ctx.isBaseline, inst, matchedInst, loc, originLoc);
+    return false;
+}
+
+// 计算移动的cost变化，按Metropolis准则与pin密度决定是否接受，调用方负责对相关net加锁
+static bool applyMtxMove(MtxContext &ctx, Instance *inst, const std::tuple<int, int, int> &loc, const std::vector<int> &relatedNets,
+                         float T, std::mt19937 &rng, bool dryRun, int &deta)
+{
+    bool isBaseline = ctx.isBaseline;
+    const int *netsBegin = relatedNets.data();
+    const int *netsEnd = netsBegin + relatedNets.size();
+    Instance *matchedInst = getMatchedInst(inst);
+    std::tuple<int, int, int> originLoc = getInstLoc(isBaseline, inst);
+    int beforeNetWL = getCachedFlatWirelength(*ctx.flat, isBaseline, netsBegin, netsEnd);
+    setInstLoc(isBaseline, inst, loc);
+    if (matchedInst != nullptr)
+        setInstLoc(isBaseline, matchedInst, loc);
+    int afterNetWL = evalFlatWirelength(*ctx.flat, isBaseline, netsBegin, netsEnd);
+    deta = afterNetWL - beforeNetWL;
+
+    bool accept = false;
+    if (!dryRun)
+    {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        accept = deta < 0 || (T > 0 && dist(rng) < exp(-deta / T));
+    }
+    if (accept)
+    {
+        //改变tile之后才能计算pin密度变化
+        changeTile(isBaseline, originLoc, loc, inst);
+        accept = tryMtxPinDensity(ctx, inst, matchedInst, originLoc, loc);
+        if (!accept)
+            changeTile(isBaseline, loc, originLoc, inst);
+    }
+    if (accept)
+    {
+        commitFlatWirelength(*ctx.flat, isBaseline, netsBegin, netsEnd);
+    }
+    else
+    {
+        //复原
+        setInstLoc(isBaseline, inst, originLoc);
+        if (matchedInst != nullptr)
+            setInstLoc(isBaseline, matchedInst, originLoc);
+    }
+    return accept;
+}
+
+// 线程tid的一次移动
+static void mtxMove(MtxContext &ctx, int tid, MtxWorker &worker)
+{
+    if (worker.fitness.getNumNets() == 0)
+        return;
+    int netIdx = worker.fitness.sampleNet(worker.rng);
+
+    // 在net锁内选inst、读取中心，只选本线程区域内的inst
+    const int selectTries = 4;
+    Instance *inst = nullptr;
+    int xCur = -1, yCur = -1, zCur = -1;
+    int centerX, centerY;
+    ctx.netLocks[netIdx].lock();
+    for (int i = 0; i < selectTries && inst == nullptr; i++)
+    {
+        inst = glbMoveGen.selectInst(netIdx, worker.rng);
+        if (inst == nullptr)
+            break;
+        std::tie(xCur, yCur, zCur) = getInstLoc(ctx.isBaseline, inst);
+        if (ctx.getOwner(xCur, yCur) != tid)
+            inst = nullptr;
+    }
+    if (inst != nullptr)
+        std::tie(centerX, centerY) = ctx.flat->getNetCenter(netIdx, ctx.isBaseline);
+    ctx.netLocks[netIdx].unlock();
+    if (inst == nullptr)
+        return;
+
+    const MtxRegion &region = ctx.regions[ctx.getTileRegion(xCur, yCur)];
+    // 目标框限制在inst所在的区域内
+    int rangeDesired = worker.fitness.getDesiredRange(netIdx);
+    int xl = std::max(centerX - rangeDesired, region.xl);
+    int xr = std::min(centerX + rangeDesired, region.xr);
+    int yl = std::max(centerY - rangeDesired, region.yb);
+    int yr = std::min(centerY + rangeDesired, region.yt);
+    if (xl > xr || yl > yr)
+    {
+        // 目标框在其它区域，留到同步点处理
+        std::lock_guard<std::mutex> lock(mtx);
+        ctx.deferred.push_back({inst, netIdx, rangeDesired});
+        return;
+    }
+    int x, y, z;
+    std::tie(x, y, z) = findSuitableLocInWindow(ctx.isBaseline, xl, xr, yl, yr, inst, worker.rng, worker.coordinates);
+    if (z == -1)
+        return;
+
+    collectRelatedNets(ctx, inst, worker.relatedNets);
+    int deta = 0;
+    lockNets(ctx, worker.relatedNets);
+    bool accept = applyMtxMove(ctx, inst, std::make_tuple(x, y, z), worker.relatedNets, ctx.T, worker.rng, false, deta);
+    unlockNets(ctx, worker.relatedNets);
+    worker.stat.tried++;
+    if (accept)
+    {
+        worker.stat.accepted++;
+        worker.stat.deta += deta;
+    }
+
+    // 间隔一段时间更新相关net的range与fitness
+    worker.counterNet++;
+    if (worker.counterNet % 100 == 0)
+    {
+        for (int n : worker.relatedNets)
+        {
+            std::lock_guard<std::mutex> lock(ctx.netLocks[n]);
+            worker.fitness.updateNet(n);
+        }
+    }
+    if (worker.counterNet == 800)
+    {
+        worker.fitness.promoteActual();
+        worker.counterNet = 0;
+    }
+}
+
+// 同步点串行处理跨区域移动，此时没有其它线程在运行
+static void settleDeferredMoves(MtxContext &ctx, MtxWorker &serial)
+{
+    for (const MtxDeferredMove &move : ctx.deferred)
+    {
+        Instance *inst = move.inst;
+        int centerX, centerY;
+        std::tie(centerX, centerY) = ctx.flat->getNetCenter(move.netIdx, ctx.isBaseline);
+        int rangeDesired = move.rangeDesired;
+        int xl = std::max(centerX - rangeDesired, 0);
+        int xr = std::min(centerX + rangeDesired, ctx.numCol - 1);
+        int yl = std::max(centerY - rangeDesired, 0);
+        int yr = std::min(centerY + rangeDesired, ctx.numRow - 1);
+        int x, y, z;
+        std::tie(x, y, z) = findSuitableLocInWindow(ctx.isBaseline, xl, xr, yl, yr, inst, serial.rng, serial.coordinates);
+        if (z == -1)
+            continue;
+        collectRelatedNets(ctx, inst, serial.relatedNets);
+        int deta = 0;
+        serial.stat.tried++;
+        if (applyMtxMove(ctx, inst, std::make_tuple(x, y, z), serial.relatedNets, ctx.T, serial.rng, false, deta))
+        {
+            serial.stat.accepted++;
+            serial.stat.deta += deta;
+        }
+    }
+    ctx.deferred.clear();
+}
+
+// 线程tid：先建自己的fitness，之后每轮在两个barrier之间跑InnerIter次移动
+static void mtxWorkerLoop(MtxContext &ctx, std::vector<MtxWorker> &workers, int tid, MtxBarrier &barrier,
+                          const std::chrono::high_resolution_clock::time_point &start, int timeLimit)
+{
+    MtxWorker &worker = workers[tid];
+    worker.fitness.build(*ctx.flat, glbPlacementState[ctx.isBaseline], worker.nets);
+    barrier.wait();
+    while (true)
+    {
+        barrier.wait(); // 等待主线程设置本轮的温度
+        if (ctx.stop)
+            break;
+        for (int iter = 0; iter < ctx.InnerIter; iter++)
+        {
+            if (iter % 100 == 0)
+            {
+                if (timeupMtx)
+                    break;
+                std::chrono::duration<double> durationtmp = std::chrono::high_resolution_clock::now() - start;
+                if (durationtmp.count() >= timeLimit)
+                {
+                    timeupMtx = true;
+                    break;
+                }
+            }
+            mtxMove(ctx, tid, worker);
+        }
+        barrier.wait(); // 本轮结束
+    }
+}
+
 //多线程版本
-int arbsaMtx(bool isBaseline){
+int arbsaMtx(bool isBaseline, int numThreads)
+{
+    // 记录开始时间
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MtxContext ctx;
+    ctx.isBaseline = isBaseline;
+    ctx.numCol = chip.getNumCol();
+    ctx.numRow = chip.getNumRow();
+
+    // 划分区域
+    for (int i = 0; i < chip.getNumClockCol(); i++)
+    {
+        for (int j = 0; j < chip.getNumClockRow(); j++)
+        {
+            ClockRegion *clockRegion = chip.getClockRegion(i, j);
+            ctx.regions.push_back({clockRegion->getXLeft(), clockRegion->getXRight(), clockRegion->getYBottom(), clockRegion->getYTop()});
+        }
+    }
+    if (ctx.regions.empty())
+    {
+        std::cout << "[ERROR] arbsaMtx: no clock region found" << std::endl;
+        return 1;
+    }
+    ctx.tileRegion.assign(ctx.numCol * ctx.numRow, -1);
+    for (int r = 0; r < (int)ctx.regions.size(); r++)
+    {
+        const MtxRegion &region = ctx.regions[r];
+        for (int x = std::max(region.xl, 0); x <= std::min(region.xr, ctx.numCol - 1); x++)
+        {
+            for (int y = std::max(region.yb, 0); y <= std::min(region.yt, ctx.numRow - 1); y++)
+            {
+                ctx.tileRegion[x * ctx.numRow + y] = r;
+            }
+        }
+    }
+    if (numThreads <= 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+        numThreads = maxThreads;
+    numThreads = std::min(numThreads, (int)ctx.regions.size());
+    ctx.numThreads = numThreads;
+    ctx.regionOwner.resize(ctx.regions.size());
+    for (int r = 0; r < (int)ctx.regions.size(); r++)
+    {
+        ctx.regionOwner[r] = r % numThreads;
+    }
+
+    glbFlatNetlist.build(glbNetMap);
+    glbMoveGen.build(glbFlatNetlist, isBaseline);
+    const FlatNetlist &flat = glbFlatNetlist;
+    ctx.flat = &flat;
+    int numNets = flat.getNumNets();
+    // 每个net一把锁
+    std::vector<std::mutex> netLocks(numNets);
+    ctx.netLocks.swap(netLocks);
+
+    // pin密度按跨tile连接计数增量计算，线程中不能回退到遍历tile的pin
+    if (!glbTilePinCounter.isBuilt(isBaseline))
+        glbTilePinCounter.build(isBaseline);
+
+    //设置引脚数超过该数字的net为bigNet
+    const int pinNumLimit = 5000;
+    int bigNetCost = 0;
+    if (findBigNetId(pinNumLimit))
+    {
+        bigNetCost = getRelatedWirelength(isBaseline, glbBigNet);
+    }
+    ctx.isBigNet.assign(numNets, 0);
+    for (int netId : glbBigNet)
+    {
+        int idx = flat.getNetIndex(netId);
+        if (idx != -1)
+            ctx.isBigNet[idx] = 1;
+    }
+
+    // net分给驱动inst所在区域的线程，没有driver时按第一个pin
+    const int seed = 999;
+    std::vector<MtxWorker> workers(numThreads);
+    for (int tid = 0; tid < numThreads; tid++)
+    {
+        workers[tid].rng.seed(seed + tid * 7919);
+    }
+    for (int n = 0; n < numNets; n++)
+    {
+        if (ctx.isBigNet[n] || flat.getPinInstsBegin(n) == flat.getPinInstsEnd(n))
+            continue;
+        int x, y, z;
+        std::tie(x, y, z) = getInstLoc(isBaseline, flat.getInst(*flat.getPinInstsBegin(n)));
+        int owner = ctx.getOwner(x, y);
+        if (owner == -1)
+            owner = n % numThreads;
+        workers[owner].nets.push_back(n);
+    }
+
+    int InnerIter = 2000; // 每个线程每轮的迭代次数
+    float T = 2;
+    float threashhold = 0;
+    float alpha = 0.8;
+    const int timeLimit = TIME_LIMIT_MTX;
+    invalidateWirelengthCache(glbNetMap);
+    chip.rebuildTileOccupancy();
+    int cost = getWirelength(isBaseline);
+    MtxWorker serial;
+    serial.rng.seed(seed);
+
+    // 根据标准差设置初始温度，试探移动不修改布局
+    std::vector<int> sigmaVecInit;
+    for (int i = 0; i < 50 && numNets > 0; i++)
+    {
+        std::uniform_int_distribution<int> dist(0, numNets - 1);
+        int netIdx = dist(serial.rng);
+        if (ctx.isBigNet[netIdx])
+            continue;
+        Instance *inst = glbMoveGen.selectInst(netIdx, serial.rng);
+        if (inst == nullptr)
+            continue;
+        int centerX, centerY;
+        std::tie(centerX, centerY) = flat.getNetCenter(netIdx, isBaseline);
+        int rangeDesired = flat.getNetHPWL(netIdx, isBaseline) / 2;
+        int x, y, z;
+        std::tie(x, y, z) = findSuitableLocInWindow(isBaseline, std::max(centerX - rangeDesired, 0), std::min(centerX + rangeDesired, ctx.numCol - 1),
+                                                    std::max(centerY - rangeDesired, 0), std::min(centerY + rangeDesired, ctx.numRow - 1), inst, serial.rng,
+                                                    serial.coordinates);
+        if (z == -1)
+            continue;
+        collectRelatedNets(ctx, inst, serial.relatedNets);
+        int deta = 0;
+        applyMtxMove(ctx, inst, std::make_tuple(x, y, z), serial.relatedNets, T, serial.rng, true, deta);
+        if (deta < 0)
+        {
+            sigmaVecInit.emplace_back(cost + deta);
+        }
+    }
+    double standardDeviation = calculateStandardDeviation(sigmaVecInit);
+    if (standardDeviation != 0)
+    {
+        T = 0.5 * standardDeviation;
+    }
+    std::cout << "------------------------------------------------\n";
+    std::cout << "[INFO] The multi-thread simulated annealing algorithm starts " << std::endl;
+    std::cout << "[INFO] threads = " << numThreads << ", regions = " << ctx.regions.size() << ", initial temperature T = " << T
+              << ", InnerIter = " << InnerIter << ", seed = " << seed << std::endl;
+
+    // 线程只创建一次，主线程也参与barrier
+    timeupMtx = false;
+    ctx.stop = false;
+    ctx.InnerIter = InnerIter;
+    MtxBarrier barrier(numThreads + 1);
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < numThreads; tid++)
+    {
+        threads.emplace_back(mtxWorkerLoop, std::ref(ctx), std::ref(workers), tid, std::ref(barrier), std::cref(start), timeLimit);
+    }
+    barrier.wait(); // 各线程的fitness建好
+
+    int round = 0;
+    long long totalMoves = 0;
+    // 外层循环 每轮所有线程并行跑InnerIter次，之后同步
+    while (T > threashhold && !timeupMtx)
+    {
+        ctx.T = T;
+        for (MtxWorker &worker : workers)
+        {
+            worker.stat.tried = worker.stat.accepted = 0;
+            worker.stat.deta = 0;
+        }
+        serial.stat.tried = serial.stat.accepted = 0;
+        serial.stat.deta = 0;
+        barrier.wait(); // 开始本轮
+        barrier.wait(); // 各线程跑完本轮
+
+        // 同步点：处理跨区域移动并汇总
+        settleDeferredMoves(ctx, serial);
+        int tried = serial.stat.tried, accepted = serial.stat.accepted;
+        cost += serial.stat.deta;
+        for (MtxWorker &worker : workers)
+        {
+            tried += worker.stat.tried;
+            accepted += worker.stat.accepted;
+            cost += worker.stat.deta;
+        }
+        totalMoves += tried;
+        // 更新 bigNet cost
+        if (glbBigNetPinNum > 0)
+        {
+            int bigNetCostCur = getRelatedWirelength(isBaseline, glbBigNet);
+            cost = cost - bigNetCost + bigNetCostCur;
+            bigNetCost = bigNetCostCur;
+        }
+
+#ifdef INFO
+        std::cout << "[INFO] T:" << std::scientific << std::setprecision(3) << T << " round:" << std::setw(4) << round << " alpha:" << std::fixed << std::setprecision(2) << alpha
+                  << " accept:" << accepted << "/" << tried << " cost:" << std::setw(7) << cost << std::endl;
+#endif
+        double acceptRate = tried > 0 ? (double)accepted / tried : 0;
+        if (0.96 <= acceptRate)
+        {
+            alpha = 0.5;
+        }
+        else if (0.8 <= acceptRate && acceptRate < 0.96)
+        {
+            alpha = 0.9;
+        }
+        else if (0.16 <= acceptRate && acceptRate < 0.8)
+        {
+            alpha = 0.95;
+        }
+        else
+        {
+            alpha = 0.8;
+        }
+        T = alpha * T;
+        round++;
+    }
+    ctx.stop = true;
+    barrier.wait();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
 
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << "[INFO] threads: " << numThreads << ", moves: " << totalMoves << ", moves/s: " << (long long)(totalMoves / std::max(duration.count(), 1e-6)) << std::endl;
+    std::cout << "runtime: " << duration.count() << " s" << std::endl;
+    glbSteinerCache.report();
+    glbMoveGen.clear();
+    glbFlatNetlist.clear();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,474 @@
+#include <iomanip>
+#include "global.h"
+#include "object.h"
+#include "arbsa.h"
+#include <algorithm>
+#include <cmath>
+#include "wirelength.h"
+#include "netlistcsr.h"
+#include "movegen.h"
+#include "netfitness.h"
+#include "steinercache.h"
+#include <random>
+#include <unordered_map>
+// 计时
+#include <chrono>
+//多线程
+#include <thread>
+#include <atomic>
+
+#define INFO  //是否输出每次的迭代信息
+#define TIME_LIMIT_PT 1180
+
+const int maxReplicas = 8;          // 副本数上限，按核数取
+const float ladderRatio = 1.6;      // 相邻两级的温度比
+const float minTemperature = 1e-4;  // cost为整数，低于该温度时等同于只接受不变差的移动
+const int probeLimit = 256;         // 目标框大于该面积时随机试探，不再枚举所有坐标
+
+/*
+并行回火（replica exchange）版本的newArbsa
+1、每个副本有自己的PlacementState（按instID的坐标）、改过的tile占用（写时复制，没改过的直接读chip）、
+   每个pack net的线长与fitness，退火中不修改Instance与tile，所以各副本在自己的线程上同时移动，不需要加锁
+2、副本按温度阶梯排列，第k级温度为 T * ladderRatio^k。每轮每个副本跑InnerIter次移动，之后在同步点对相邻两级的副本
+   以 min(1, exp((cost_a - cost_b) * (1/T_a - 1/T_b))) 的概率交换温度，奇偶轮交替
+3、T按最冷一级副本的接受率更新，与newArbsa相同
+4、同步点记录cost最小的副本坐标，结束时把所有移动过的inst先从原tile删除，再插入新位置并写回Instance
+SEQ按bank打包（isSeqPack）时退回newArbsa
+*/
+
+struct PTReplica
+{
+    PlacementState state;                             // 副本的坐标，按instID
+    std::unordered_map<int, TileOccupancy> occupancy; // 改过的tile，x*numRow+y -> 占用状态
+    std::vector<int> netWL;                           // 每个pack net的线长，clock net为0
+    std::vector<int> relatedWL;                       // 移动时相关net的新线长
+    int cost = 0;
+    NetFitness fitness;
+    std::mt19937 rng;
+    int counterNet = 0;
+    // 本轮的统计
+    int tried = 0;
+    int accepted = 0;
+};
+
+struct PTContext
+{
+    bool isBaseline;
+    int numCol;
+    int numRow;
+    const FlatNetlist *flat;
+};
+
+static std::tuple<int, int, int> getInstLoc(bool isBaseline, Instance *inst)
+{
+    return isBaseline ? inst->getBaseLocation() : inst->getLocation();
+}
+
+static const TileOccupancy &getReplicaOccupancy(const PTContext &ctx, const PTReplica &rep, int x, int y)
+{
+    auto it = rep.occupancy.find(x * ctx.numRow + y);
+    if (it != rep.occupancy.end())
+        return it->second;
+    return chip.getTile(x, y)->getOccupancy(ctx.isBaseline);
+}
+
+// 第一次修改时从chip复制
+static TileOccupancy &getReplicaOccupancyForWrite(const PTContext &ctx, PTReplica &rep, int x, int y)
+{
+    int key = x * ctx.numRow + y;
+    auto it = rep.occupancy.find(key);
+    if (it == rep.occupancy.end())
+    {
+        it = rep.occupancy.emplace(key, chip.getTile(x, y)->getOccupancy(ctx.isBaseline)).first;
+    }
+    return it->second;
+}
+
+// 与Tile::clearSlot对LUT slot的效果相同
+static void clearLutSlot(TileOccupancy &occ, int z)
+{
+    occ.lutCount[z] = 0;
+    occ.lutUsed &= ~(1 << z);
+    occ.lutPacked &= ~(1 << z);
+    occ.lutInputNets[z].clear();
+}
+
+// 与changePackTile相同的slot修改，只作用在副本的占用状态上
+static void moveReplicaOccupancy(const PTContext &ctx, PTReplica &rep, Instance *inst, int xCur, int yCur, int zCur, int x, int y, int z)
+{
+    static const std::string lutType = "LUT";
+    static const std::string seqType = "SEQ";
+    bool isLUT = inst->getModelName().compare(0, 3, "LUT") == 0;
+    const std::string &slotType = isLUT ? lutType : seqType;
+    TileOccupancy &occCur = getReplicaOccupancyForWrite(ctx, rep, xCur, yCur);
+    if (isLUT && inst->getMatchedLUTID() != -1)
+        clearLutSlot(occCur, zCur);
+    else
+        occupancyRemove(occCur, slotType, zCur, inst);
+    occupancyAdd(getReplicaOccupancyForWrite(ctx, rep, x, y), slotType, z, inst);
+}
+
+// 在[xl,xr]x[yl,yr]内随机找一个副本中可放置的位置，不含inst当前所在的tile
+static bool findReplicaLoc(const PTContext &ctx, PTReplica &rep, int xl, int xr, int yl, int yr, Instance *inst, int xCur, int yCur, int &xx, int &yy, int &zz)
+{
+    if ((xr - xl + 1) * (yr - yl + 1) > probeLimit)
+    {
+        // 大框随机试探
+        std::uniform_int_distribution<int> distX(xl, xr), distY(yl, yr);
+        for (int i = 0; i < probeLimit; i++)
+        {
+            xx = distX(rep.rng);
+            yy = distY(rep.rng);
+            if (isPLB[xx][yy] && (xx != xCur || yy != yCur) && isPackValidAt(getReplicaOccupancy(ctx, rep, xx, yy), zz, inst, false))
+                return true;
+        }
+        return false;
+    }
+    static thread_local std::vector<std::pair<int, int>> coordinates;
+    coordinates.clear();
+    for (int x = xl; x <= xr; ++x)
+    {
+        for (int y = yl; y <= yr; ++y)
+        {
+            if (isPLB[x][y] && (x != xCur || y != yCur))
+            {
+                coordinates.emplace_back(x, y);
+            }
+        }
+    }
+    while (!coordinates.empty())
+    {
+        std::uniform_int_distribution<int> dist(0, coordinates.size() - 1);
+        int randomIndex = dist(rep.rng);
+        xx = coordinates[randomIndex].first;
+        yy = coordinates[randomIndex].second;
+        if (isPackValidAt(getReplicaOccupancy(ctx, rep, xx, yy), zz, inst, false))
+            return true;
+        // 移除不符合规则的坐标
+        coordinates[randomIndex] = coordinates.back();
+        coordinates.pop_back();
+    }
+    return false;
+}
+
+// 按fitness偏向地随机选取net，跳过bigNet
+static int selectReplicaNet(const PTContext &ctx, PTReplica &rep)
+{
+    int netIdx = rep.fitness.sampleNet(rep.rng);
+    if (glbBigNetPinNum > 0)
+    {
+        while (glbBigNet.find(ctx.flat->getNetId(netIdx)) != glbBigNet.end())
+        {
+            netIdx = rep.fitness.sampleNet(rep.rng);
+        }
+    }
+    return netIdx;
+}
+
+// 副本的一次移动，按Metropolis准则决定是否接受。dryRun只计算deta，不修改副本
+// 返回false表示没有找到可移动的inst或位置
+static bool replicaMove(const PTContext &ctx, PTReplica &rep, float T, bool dryRun, int &deta)
+{
+    const FlatNetlist &flat = *ctx.flat;
+    int netIdx = selectReplicaNet(ctx, rep);
+    Instance *inst = glbMoveGen.selectInst(netIdx, rep.rng);
+    if (inst == nullptr)
+        return false;
+
+    int centerX, centerY;
+    std::tie(centerX, centerY) = flat.getNetCenter(netIdx, rep.state);
+    int rangeDesired = rep.fitness.getDesiredRange(netIdx);
+    int xl = std::max(centerX - rangeDesired, 0);
+    int xr = std::min(centerX + rangeDesired, ctx.numCol - 1);
+    int yl = std::max(centerY - rangeDesired, 0);
+    int yr = std::min(centerY + rangeDesired, ctx.numRow - 1);
+    int instID = inst->getInstID();
+    int xCur = rep.state.x[instID], yCur = rep.state.y[instID], zCur = rep.state.z[instID];
+    int x, y, z;
+    if (!findReplicaLoc(ctx, rep, xl, xr, yl, yr, inst, xCur, yCur, x, y, z))
+        return false;
+
+    // 计算移动后相关net的线长
+    int instIdx = flat.getInstIndex(inst);
+    const int *netsBegin = flat.getInstNetsBegin(instIdx);
+    const int *netsEnd = flat.getInstNetsEnd(instIdx);
+    rep.state.set(instID, std::make_tuple(x, y, z));
+    deta = 0;
+    rep.relatedWL.clear();
+    for (const int *n = netsBegin; n != netsEnd; ++n)
+    {
+        int wl = flat.isClock(*n) ? 0 : flat.getNetWireLength(*n, rep.state);
+        rep.relatedWL.push_back(wl);
+        deta += wl - rep.netWL[*n];
+    }
+
+    bool accept = false;
+    if (!dryRun)
+    {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        accept = deta < 0 || dist(rep.rng) < exp(-deta / T);
+        rep.tried++;
+    }
+    if (accept)
+    {
+        moveReplicaOccupancy(ctx, rep, inst, xCur, yCur, zCur, x, y, z);
+        for (int k = 0; k < (int)rep.relatedWL.size(); k++)
+        {
+            rep.netWL[netsBegin[k]] = rep.relatedWL[k];
+        }
+        rep.cost += deta;
+        rep.accepted++;
+    }
+    else
+    {
+        //复原
+        rep.state.set(instID, std::make_tuple(xCur, yCur, zCur));
+    }
+    if (dryRun)
+        return true;
+
+    // 间隔更新fitness，与newArbsa相同
+    const int counterNetLimit = 800;
+    rep.counterNet++;
+    if (rep.counterNet % 100 == 0)
+    {
+        for (const int *n = netsBegin; n != netsEnd; ++n)
+        {
+            rep.fitness.updateNet(*n);
+        }
+    }
+    if (rep.counterNet == counterNetLimit)
+    {
+        rep.fitness.promoteActual();
+        rep.counterNet = 0;
+    }
+    return true;
+}
+
+// 把最优副本写回Instance与tile，返回移动过的inst数
+static int writeBackReplica(bool isBaseline, const FlatNetlist &flat, const PlacementState &best)
+{
+    std::vector<std::pair<Instance *, std::tuple<int, int, int>>> moved;
+    for (int i = 0; i < flat.getNumInsts(); i++)
+    {
+        Instance *inst = flat.getInst(i);
+        int instID = inst->getInstID();
+        std::tuple<int, int, int> loc = std::make_tuple(best.x[instID], best.y[instID], best.z[instID]);
+        if (loc != getInstLoc(isBaseline, inst))
+        {
+            moved.emplace_back(inst, loc);
+        }
+    }
+    // 先全部从原tile删除，再插入新位置，避免目标slot还被没写回的inst占着
+    for (auto &it : moved)
+    {
+        removePackTile(isBaseline, getInstLoc(isBaseline, it.first), it.first);
+    }
+    for (auto &it : moved)
+    {
+        addPackTile(isBaseline, it.second, it.first, false);
+        if (isBaseline)
+            it.first->setBaseLocation(it.second);
+        else
+            it.first->setLocation(it.second);
+    }
+    return moved.size();
+}
+
+//并行回火版本
+int newArbsaPT(bool isBaseline, bool isSeqPack)
+{
+    if (isSeqPack)
+    {
+        std::cout << "[INFO] parallel tempering does not support SEQ bank packing, fall back to newArbsa" << std::endl;
+        return newArbsa(isBaseline, isSeqPack);
+    }
+    // 记录开始时间
+    auto start = std::chrono::high_resolution_clock::now();
+
+    glbFlatNetlist.build(glbNetMap);
+    glbFlatPackNetlist.build(glbPackNetMap);
+    glbMoveGen.build(glbFlatPackNetlist, isBaseline);
+    invalidateWirelengthCache(glbPackNetMap);
+    chip.rebuildTileOccupancy();
+
+    PTContext ctx;
+    ctx.isBaseline = isBaseline;
+    ctx.numCol = chip.getNumCol();
+    ctx.numRow = chip.getNumRow();
+    ctx.flat = &glbFlatPackNetlist;
+    const FlatNetlist &flat = glbFlatPackNetlist;
+
+    int numReplicas = std::thread::hardware_concurrency();
+    if (numReplicas <= 0)
+        numReplicas = maxReplicas;
+    numReplicas = std::max(2, std::min(numReplicas, maxReplicas));
+
+    int InnerIter = 2000; // 每个副本每轮的迭代次数
+    float T = 2;
+    float alpha = 0.8;
+    const int seed = 999;
+    const int timeLimit = TIME_LIMIT_PT;
+
+    // 初始线长，所有副本从同一个布局开始
+    std::vector<int> initNetWL(flat.getNumNets(), 0);
+    int initCost = 0;
+    for (int n = 0; n < flat.getNumNets(); n++)
+    {
+        if (!flat.isClock(n))
+        {
+            initNetWL[n] = flat.getNetWireLength(n, glbPlacementState[isBaseline]);
+            initCost += initNetWL[n];
+        }
+    }
+    std::vector<PTReplica> replicas(numReplicas);
+    for (int k = 0; k < numReplicas; k++)
+    {
+        PTReplica &rep = replicas[k];
+        rep.state = glbPlacementState[isBaseline];
+        rep.netWL = initNetWL;
+        rep.cost = initCost;
+        rep.fitness.build(flat, rep.state);
+        rep.rng.seed(seed + k * 7919);
+    }
+    std::mt19937 serialRng(seed);
+
+    // 根据标准差设置初始温度，试探移动不修改副本
+    std::vector<int> sigmaVecInit;
+    for (int i = 0; i < 50; i++)
+    {
+        int deta = 0;
+        if (replicaMove(ctx, replicas[0], T, true, deta) && deta < 0)
+        {
+            sigmaVecInit.emplace_back(initCost + deta);
+        }
+    }
+    double standardDeviation = calculateStandardDeviation(sigmaVecInit);
+    if (standardDeviation != 0)
+    {
+        T = 0.5 * standardDeviation;
+    }
+    std::cout << "------------------------------------------------\n";
+    std::cout << "[INFO] The parallel tempering simulated annealing algorithm starts " << std::endl;
+    std::cout << "[INFO] replicas = " << numReplicas << ", ladder ratio = " << ladderRatio << ", initial temperature T = " << T
+              << ", InnerIter = " << InnerIter << ", seed = " << seed << ", cost = " << initCost << std::endl;
+
+    // replicaAt[k]为第k级温度上的副本，0级最冷
+    std::vector<int> replicaAt(numReplicas);
+    for (int k = 0; k < numReplicas; k++)
+    {
+        replicaAt[k] = k;
+    }
+    PlacementState bestState = glbPlacementState[isBaseline];
+    int bestCost = initCost;
+
+    std::atomic<bool> timeup(false);
+    int round = 0;
+    int numSwaps = 0, numSwapTries = 0;
+    // 外层循环 每轮所有副本并行跑InnerIter次，之后同步
+    while (!timeup)
+    {
+        std::vector<std::thread> threads;
+        for (int level = 0; level < numReplicas; level++)
+        {
+            PTReplica *rep = &replicas[replicaAt[level]];
+            float TLevel = T * std::pow(ladderRatio, level);
+            rep->tried = 0;
+            rep->accepted = 0;
+            threads.emplace_back([&ctx, &timeup, &start, rep, TLevel, InnerIter, timeLimit]()
+                                 {
+                for (int iter = 0; iter < InnerIter; iter++)
+                {
+                    if (iter % 100 == 0)
+                    {
+                        if (timeup)
+                            break;
+                        std::chrono::duration<double> durationtmp = std::chrono::high_resolution_clock::now() - start;
+                        if (durationtmp.count() >= timeLimit)
+                        {
+                            timeup = true;
+                            break;
+                        }
+                    }
+                    int deta = 0;
+                    replicaMove(ctx, *rep, TLevel, false, deta);
+                } });
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        // 同步点：记录最优副本
+        for (const PTReplica &rep : replicas)
+        {
+            if (rep.cost < bestCost)
+            {
+                bestCost = rep.cost;
+                bestState = rep.state;
+            }
+        }
+        const PTReplica &coldest = replicas[replicaAt[0]];
+        double acceptRate = coldest.tried > 0 ? (double)coldest.accepted / coldest.tried : 0;
+
+        // 相邻两级交换温度，奇偶轮交替
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        for (int level = round % 2; level + 1 < numReplicas; level += 2)
+        {
+            const PTReplica &a = replicas[replicaAt[level]];
+            const PTReplica &b = replicas[replicaAt[level + 1]];
+            double Ta = T * std::pow(ladderRatio, level);
+            double Tb = T * std::pow(ladderRatio, level + 1);
+            double exponent = (a.cost - b.cost) * (1.0 / Ta - 1.0 / Tb);
+            numSwapTries++;
+            if (exponent >= 0 || dist(serialRng) < exp(exponent))
+            {
+                std::swap(replicaAt[level], replicaAt[level + 1]);
+                numSwaps++;
+            }
+        }
+
+#ifdef INFO
+        std::cout << "[INFO] T:" << std::scientific << std::setprecision(3) << T << " round:" << std::setw(4) << round << " alpha:" << std::fixed << std::setprecision(2) << alpha
+                  << " accept:" << acceptRate << " swaps:" << numSwaps << "/" << numSwapTries << " cost:" << std::setw(7) << replicas[replicaAt[0]].cost << " best:" << std::setw(7) << bestCost << std::endl;
+#endif
+        if (0.96 <= acceptRate)
+        {
+            alpha = 0.5;
+        }
+        else if (0.8 <= acceptRate && acceptRate < 0.96)
+        {
+            alpha = 0.9;
+        }
+        else if (0.16 <= acceptRate && acceptRate < 0.8)
+        {
+            alpha = 0.95;
+        }
+        else
+        {
+            alpha = 0.8;
+        }
+        T = std::max(alpha * T, minTemperature);
+        round++;
+    }
+
+    // 写回最优副本
+    int numMoved = writeBackReplica(isBaseline, flat, bestState);
+    invalidateWirelengthCache(glbPackNetMap);
+    std::cout << "[INFO] rounds = " << round << ", swaps = " << numSwaps << "/" << numSwapTries << ", moved insts = " << numMoved
+              << ", best cost = " << bestCost << ", cost after write back = " << getPackWirelength(isBaseline) << std::endl;
+
+    // 记录结束时间
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << "runtime: " << duration.count() << " s" << std::endl;
+    glbSteinerCache.report();
+
+    glbFlatNetlist.clear();
+    glbFlatPackNetlist.clear();
+    glbMoveGen.clear();
+    // 还原最终结果映射
+    recoverAllMap(isSeqPack);
+
+    return 0;
+}
@@ -8,6 +8,10 @@
 
 Arch::~Arch() {
   // Implementation of destructor
+  clearGrid();
+}
+
+void Arch::clearGrid() {
   if (tileArray != nullptr) {
     for (int i = 0; i < numCol; i++) {
       for (int j = 0; j < numRow; j++) {
@@ -16,6 +20,7 @@ Arch::~Arch() {
       delete[] tileArray[i];
     }
     delete[] tileArray;
+    tileArray = nullptr;
   }
 
   if (clockRegionArray != nullptr) {
@@ -26,7 +31,9 @@ Arch::~Arch() {
       delete[] clockRegionArray[i];
     }
     delete[] clockRegionArray;
+    clockRegionArray = nullptr;
   }
+  numCol = numRow = numClockCol = numClockRow = 0;
 }
 
 void Arch::createTileArray(int numCol, int numRow) {
@@ -215,6 +222,14 @@ bool Arch::readArch(std::string sclFileName, std::string clkFileName) {
   return true;
 }
 
+void Arch::createGrid(int numCol, int numRow, int numClockCol, int numClockRow) {
+  createTileArray(numCol, numRow);
+  setNumCol(numCol);
+  setNumRow(numRow);
+  createClockRegionArray(numClockCol, numClockRow);
+  setNumClockCol(numClockCol);
+  setNumClockRow(numClockRow);
+}
 
 void Arch::cleanSlots() {
   // Implementation of cleanSlots function
@@ -225,6 +240,16 @@ void Arch::cleanSlots() {
   }
 }
 
+void Arch::rebuildTileOccupancy() {
+  for (int i = 0; i < numCol; i++) {
+    for (int j = 0; j < numRow; j++) {
+      if (tileArray[i][j] != nullptr) {
+        tileArray[i][j]->rebuildOccupancy();
+      }
+    }
+  }
+}
+
 void Arch::reportArch() {
   // Implementation of reportArch function
   std::cout << "  Number of columns: " << numCol << std::endl;
@@ -0,0 +1,80 @@
+#include "besttracker.h"
+
+void BestTracker::begin(int cost)
+{
+    bestCost = cost;
+    clearLog();
+}
+
+void BestTracker::clearLog()
+{
+    moves.clear();
+    for (auto &it : snapshot)
+    {
+        inSnapshot[it.first->getInstID()] = 0;
+    }
+    snapshot.clear();
+}
+
+void BestTracker::recordMove(Instance *inst, Instance *matchedInst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc)
+{
+    if ((int)moves.size() >= MAX_MOVES)
+    {
+        compact();
+    }
+    moves.push_back({inst, matchedInst, originLoc, loc});
+}
+
+bool BestTracker::update(int cost)
+{
+    if (cost > bestCost)
+    {
+        return false;
+    }
+    bestCost = cost;
+    clearLog();
+    return true;
+}
+
+void BestTracker::addSnapshot(Instance *inst, const std::tuple<int, int, int> &loc)
+{
+    int id = inst->getInstID();
+    if (id >= (int)inSnapshot.size())
+    {
+        inSnapshot.resize(id + 1, 0);
+    }
+    if (inSnapshot[id])
+    {
+        return;
+    }
+    inSnapshot[id] = 1;
+    snapshot.emplace_back(inst, loc);
+}
+
+void BestTracker::compact()
+{
+    // 按接受顺序，第一次出现的原坐标就是最优布局中的坐标
+    for (const Move &move : moves)
+    {
+        addSnapshot(move.inst, move.originLoc);
+        if (move.matchedInst != nullptr)
+        {
+            addSnapshot(move.matchedInst, move.originLoc);
+        }
+    }
+    moves.clear();
+}
+
+bool BestTracker::popMove(Instance *&inst, std::tuple<int, int, int> &originLoc, std::tuple<int, int, int> &loc)
+{
+    if (moves.empty())
+    {
+        return false;
+    }
+    const Move &move = moves.back();
+    inst = move.inst;
+    originLoc = move.originLoc;
+    loc = move.loc;
+    moves.pop_back();
+    return true;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include "global.h"
+#include "freesite.h"
+
+FreeSiteIndex glbFreeSiteIndex;
+
+bool FreeSiteIndex::hasFreeLUT(Tile *tile) const
+{
+    if (tile->getInstanceByType("LUT") == nullptr)
+        return false;
+    const TileOccupancy &occ = tile->getOccupancy(isBaseline);
+    // DRAM at slot0 blocks lut slot 0~3, DRAM at slot1 blocks lut slot 4~7
+    for (int idx = 0; idx < 8; idx++)
+    {
+        if ((occ.dramUsed >> (idx / 4)) & 1)
+            continue;
+        if (occ.lutCount[idx] <= 1)
+            return true;
+    }
+    return false;
+}
+
+bool FreeSiteIndex::hasFreeSEQ(Tile *tile) const
+{
+    if (tile->getInstanceByType("SEQ") == nullptr)
+        return false;
+    return tile->getOccupancy(isBaseline).seqUsed != 0xFFFF;
+}
+
+void FreeSiteIndex::add(int type, int x, int y, int delta)
+{
+    for (int i = x + 1; i <= numCol; i += i & (-i))
+    {
+        for (int j = y + 1; j <= numRow; j += j & (-j))
+        {
+            tree[type][i * (numRow + 1) + j] += delta;
+        }
+    }
+    int base = x * (numRow + 1);
+    for (int j = y + 1; j <= numRow; j += j & (-j))
+    {
+        colTree[type][base + j] += delta;
+    }
+}
+
+int FreeSiteIndex::prefix(int type, int x, int y) const
+{
+    int sum = 0;
+    for (int i = x + 1; i > 0; i -= i & (-i))
+    {
+        for (int j = y + 1; j > 0; j -= j & (-j))
+        {
+            sum += tree[type][i * (numRow + 1) + j];
+        }
+    }
+    return sum;
+}
+
+int FreeSiteIndex::colPrefix(int type, int x, int y) const
+{
+    int sum = 0;
+    int base = x * (numRow + 1);
+    for (int j = y + 1; j > 0; j -= j & (-j))
+    {
+        sum += colTree[type][base + j];
+    }
+    return sum;
+}
+
+void FreeSiteIndex::build(bool isBaseline)
+{
+    this->isBaseline = isBaseline;
+    numCol = chip.getNumCol();
+    numRow = chip.getNumRow();
+    for (int type = 0; type < 2; type++)
+    {
+        tree[type].assign((numCol + 1) * (numRow + 1), 0);
+        colTree[type].assign(numCol * (numRow + 1), 0);
+        flag[type].assign(numCol * numRow, 0);
+    }
+    built = true;
+    for (int x = 0; x < numCol; x++)
+    {
+        for (int y = 0; y < numRow; y++)
+        {
+            if (isPLB[x][y])
+                updateTile(x, y);
+        }
+    }
+}
+
+void FreeSiteIndex::updateTile(int x, int y)
+{
+    if (!built || !isPLB[x][y])
+        return;
+    Tile *tile = chip.getTile(x, y);
+    char newFlag[2];
+    newFlag[SITE_LUT] = hasFreeLUT(tile);
+    newFlag[SITE_SEQ] = hasFreeSEQ(tile);
+    for (int type = 0; type < 2; type++)
+    {
+        char &oldFlag = flag[type][x * numRow + y];
+        if (oldFlag != newFlag[type])
+        {
+            add(type, x, y, newFlag[type] - oldFlag);
+            oldFlag = newFlag[type];
+        }
+    }
+}
+
+int FreeSiteIndex::count(int type, int xl, int xr, int yl, int yr) const
+{
+    if (xl > xr || yl > yr)
+        return 0;
+    return prefix(type, xr, yr) - prefix(type, xl - 1, yr) - prefix(type, xr, yl - 1) + prefix(type, xl - 1, yl - 1);
+}
+
+bool FreeSiteIndex::sample(int type, int xl, int xr, int yl, int yr, int k, int &x, int &y) const
+{
+    if (k < 0 || k >= count(type, xl, xr, yl, yr))
+        return false;
+    // 二分找到第一个使 count(xl..m) > k 的列
+    int lo = xl, hi = xr;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (count(type, xl, mid, yl, yr) > k)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    x = lo;
+    k -= count(type, xl, x - 1, yl, yr);
+    // 在该列中找到前缀和等于 target 的最小行
+    int target = colPrefix(type, x, yl - 1) + k + 1;
+    int base = x * (numRow + 1);
+    int pos = 0;
+    int step = 1;
+    while (step * 2 <= numRow)
+        step *= 2;
+    for (; step > 0; step /= 2)
+    {
+        if (pos + step <= numRow && colTree[type][base + pos + step] < target)
+        {
+            pos += step;
+            target -= colTree[type][base + pos];
+        }
+    }
+    y = pos; // pos是树状数组下标(从1开始)减一
+    return true;
+}
@@ -3,6 +3,7 @@
 std::map<std::string, Lib*> glbLibMap;
 std::map<int, Instance*> glbInstMap;
 std::map<int, Net*> glbNetMap;
+PlacementState glbPlacementState[2]; // 下标为isBaseline，与Instance的坐标同步
 Arch chip;
 RecSteinerMinTree rsmt;
 std::string lineBreaker = "------------------------------------------";
@@ -20,8 +21,8 @@ std::map<int, Instance*> glbPackInstMap;    // 存储打包后的全局InstMap
 std::map<int, Net*> glbPackNetMap;   // 存储打包后的全局NetMap
 
 /****密度相关****/
-std::vector<std::pair<int,int> > glbPinDensity; //第一个是tile x*1000+y 第二个是密度的分子
+PinDensityTracker glbPinDensity; //key是tile x*1000+y 值是密度的分子
 int glbTopKNum;  //统计PLB的5%数量   setPinDensityMapAndTopValues
 int glbInitTopSum; //记录初始top的分子之和
 
-std::map<int, int> oldNetID2newNetID; //全局映射，存放旧netID到新netID的映射
+std::vector<int> oldNetID2newNetID; //全局映射，存放旧netID到新netID的映射，下标为旧netID
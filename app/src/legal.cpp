@@ -104,15 +104,7 @@ bool checkTypeAndCapacity(bool isBaseline)
             continue;
           }
           // check if the slot is legally occupied
-          std::list<int> instances;
-          if (isBaseline)
-          {
-            instances = slot->getBaselineInstances();
-          }
-          else
-          {
-            instances = slot->getOptimizedInstances();
-          }
+          const SlotInstances &instances = slot->getInstances(isBaseline);
           if (instances.size() > 1)
           {
             // 1) 2-LUTs are allowed but total number of input should not exceed 6
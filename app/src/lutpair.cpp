@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "global.h"
+#include "method.h"
+#include "lutpair.h"
+
+bool isLUTType(const std::string &modelName);
+int generateNewInstanceID();
+
+namespace
+{
+    const int MAX_PAIR_INPUTS = 6; // 一个LUT组最多6个不同的输入net
+    const int BATCH_SIZE = 256;
+
+    struct LutPairIndex
+    {
+        std::vector<Instance *> luts;  // 按rank排列
+        std::vector<int> lutNetStart;  // CSR，LUT rank -> 输入net下标，升序去重
+        std::vector<int> lutNets;
+        std::vector<int> netLutStart;  // CSR，net下标 -> LUT rank，升序
+        std::vector<int> netLuts;
+    };
+
+    void buildIndex(std::map<int, Instance *> &instMap, LutPairIndex &index)
+    {
+        for (const auto &instPair : instMap)
+        {
+            if (isLUTType(instPair.second->getModelName()))
+            {
+                index.luts.push_back(instPair.second);
+            }
+        }
+        // 按引脚数量从多到少排序，相同时保持id顺序
+        std::stable_sort(index.luts.begin(), index.luts.end(), [](Instance *a, Instance *b)
+                         { return a->getNumInpins() > b->getNumInpins(); });
+
+        int numLuts = index.luts.size();
+        std::vector<std::pair<int, int>> netLutPairs; // (netID, rank)
+        for (int rank = 0; rank < numLuts; rank++)
+        {
+            Instance *inst = index.luts[rank];
+            for (int i = 0; i < inst->getNumInpins(); ++i)
+            {
+                Pin *pin = inst->getInpin(i);
+                int netID = pin->getNetID();
+                // 跳过未连接的引脚或为CLOCK的net
+                if (netID == -1 || pin->getProp() == PIN_PROP_CLOCK)
+                {
+                    continue;
+                }
+                netLutPairs.emplace_back(netID, rank);
+            }
+        }
+        std::sort(netLutPairs.begin(), netLutPairs.end());
+        netLutPairs.erase(std::unique(netLutPairs.begin(), netLutPairs.end()), netLutPairs.end());
+
+        // net -> LUT，netID压缩成连续下标
+        std::vector<int> netIndexOfPair(netLutPairs.size());
+        int numNets = 0;
+        index.netLutStart.push_back(0);
+        for (size_t i = 0; i < netLutPairs.size(); i++)
+        {
+            if (i > 0 && netLutPairs[i].first != netLutPairs[i - 1].first)
+            {
+                index.netLutStart.push_back(i);
+                numNets++;
+            }
+            netIndexOfPair[i] = numNets;
+            index.netLuts.push_back(netLutPairs[i].second);
+        }
+        index.netLutStart.push_back(netLutPairs.size());
+
+        // LUT -> net，按net下标计数后填入，每个LUT的数组自然升序
+        index.lutNetStart.assign(numLuts + 1, 0);
+        for (const auto &p : netLutPairs)
+        {
+            index.lutNetStart[p.second + 1]++;
+        }
+        for (int rank = 0; rank < numLuts; rank++)
+        {
+            index.lutNetStart[rank + 1] += index.lutNetStart[rank];
+        }
+        index.lutNets.resize(netLutPairs.size());
+        std::vector<int> fill(index.lutNetStart.begin(), index.lutNetStart.end() - 1);
+        for (size_t i = 0; i < netLutPairs.size(); i++)
+        {
+            index.lutNets[fill[netLutPairs[i].second]++] = netIndexOfPair[i];
+        }
+    }
+
+    // 两个升序数组的公共元素个数
+    int countShared(const int *a, int na, const int *b, int nb)
+    {
+        int shared = 0;
+        int i = 0, j = 0;
+        while (i < na && j < nb)
+        {
+            if (a[i] < b[j])
+                i++;
+            else if (a[i] > b[j])
+                j++;
+            else
+            {
+                shared++;
+                i++;
+                j++;
+            }
+        }
+        return shared;
+    }
+
+    // 两个LUT能否组成一组，能则返回共享的net数，否则返回-1
+    int pairSharedNets(const LutPairIndex &index, int rank, int other)
+    {
+        Instance *currentLUT = index.luts[rank];
+        Instance *otherLUT = index.luts[other];
+        // 距离限制判断
+        if (calculateTwoInstanceWireLength(currentLUT, otherLUT, false) >= 1)
+            return -1;
+        // 两个 LUT 都是固定的，则跳过
+        if (currentLUT->isFixed() && otherLUT->isFixed())
+            return -1;
+
+        const int *currentNets = index.lutNets.data() + index.lutNetStart[rank];
+        int numCurrentNets = index.lutNetStart[rank + 1] - index.lutNetStart[rank];
+        const int *otherNets = index.lutNets.data() + index.lutNetStart[other];
+        int numOtherNets = index.lutNetStart[other + 1] - index.lutNetStart[other];
+        int sharedNetCount = countShared(currentNets, numCurrentNets, otherNets, numOtherNets);
+        int totalInpins = numCurrentNets + numOtherNets - sharedNetCount;
+        if (totalInpins > MAX_PAIR_INPUTS || sharedNetCount <= 1)
+            return -1;
+        return sharedNetCount;
+    }
+
+    // rank在未配对的LUT中的最佳候选，没有时返回-1
+    int findBestCandidate(const LutPairIndex &index, const std::vector<std::atomic<char>> &claimed, int rank)
+    {
+        const int *currentNets = index.lutNets.data() + index.lutNetStart[rank];
+        int numCurrentNets = index.lutNetStart[rank + 1] - index.lutNetStart[rank];
+
+        int bestRank = -1;
+        int maxSharedNets = -1;
+        for (int k = 0; k < numCurrentNets; k++)
+        {
+            int net = currentNets[k];
+            for (int p = index.netLutStart[net]; p < index.netLutStart[net + 1]; p++)
+            {
+                int other = index.netLuts[p];
+                if (other == rank || claimed[other].load(std::memory_order_relaxed))
+                    continue;
+
+                int sharedNetCount = pairSharedNets(index, rank, other);
+                if (sharedNetCount == -1)
+                    continue;
+
+                // 最大匹配模式，共享数相同时取rank小的，与遍历顺序无关
+                if (sharedNetCount > maxSharedNets || (sharedNetCount == maxSharedNets && other < bestRank))
+                {
+                    maxSharedNets = sharedNetCount;
+                    bestRank = other;
+                }
+            }
+        }
+        return bestRank;
+    }
+
+    // 多个线程按批次处理[0, count)
+    template <typename Func>
+    void parallelForBatches(int count, int numThreads, Func func)
+    {
+        std::atomic<int> next(0);
+        auto worker = [&]()
+        {
+            while (true)
+            {
+                int begin = next.fetch_add(BATCH_SIZE);
+                if (begin >= count)
+                    break;
+                int end = std::min(count, begin + BATCH_SIZE);
+                for (int i = begin; i < end; i++)
+                    func(i);
+            }
+        };
+        int usedThreads = std::min(numThreads, (count + BATCH_SIZE - 1) / BATCH_SIZE);
+        if (usedThreads <= 1)
+        {
+            worker();
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (int t = 0; t < usedThreads; t++)
+        {
+            threads.emplace_back(worker);
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+}
+
+int pairLUTs(std::map<int, Instance *> &instMap, int numThreads)
+{
+    if (numThreads <= 0)
+    {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads <= 0)
+        {
+            numThreads = 4;
+        }
+    }
+
+    LutPairIndex index;
+    buildIndex(instMap, index);
+    int numLuts = index.luts.size();
+
+    std::vector<std::atomic<char>> claimed(numLuts);
+    for (auto &flag : claimed)
+    {
+        flag.store(0, std::memory_order_relaxed);
+    }
+    std::vector<int> proposal(numLuts, -1);
+    std::vector<int> partner(numLuts, -1);
+
+    // 候选只会越来越少，找不到候选的LUT之后也不会再有
+    std::vector<int> active(numLuts);
+    for (int rank = 0; rank < numLuts; rank++)
+    {
+        active[rank] = rank;
+    }
+    int numRounds = 0;
+    while (!active.empty())
+    {
+        numRounds++;
+        parallelForBatches(active.size(), numThreads, [&](int i)
+                           {
+            int rank = active[i];
+            proposal[rank] = findBestCandidate(index, claimed, rank); });
+
+        // 互相选中的配对，由rank小的一方占用两个LUT
+        std::atomic<int> numPaired(0);
+        parallelForBatches(active.size(), numThreads, [&](int i)
+                           {
+            int rank = active[i];
+            int other = proposal[rank];
+            if (other == -1 || other < rank || proposal[other] != rank)
+                return;
+            char expected = 0;
+            if (!claimed[rank].compare_exchange_strong(expected, 1))
+                return;
+            expected = 0;
+            if (!claimed[other].compare_exchange_strong(expected, 1))
+            {
+                claimed[rank].store(0);
+                return;
+            }
+            partner[rank] = other;
+            partner[other] = rank;
+            numPaired.fetch_add(1, std::memory_order_relaxed); });
+
+        if (numPaired.load() == 0)
+            break;
+        std::vector<int> stillActive;
+        for (int rank : active)
+        {
+            if (partner[rank] == -1 && proposal[rank] != -1)
+            {
+                stillActive.push_back(rank);
+            }
+        }
+        active.swap(stillActive);
+    }
+
+    // 互选结束时剩下的LUT都已经没有未配对的候选，再串行找长度为3的增广路：
+    // 未配对的u可以与已配对的a组成一组，a原来的搭档b又能与另一个未配对的v组成一组，则改为(u,a)、(b,v)，组数加一
+    // 按rank顺序处理，结果与线程数无关
+    int numAugmented = 0;
+    for (int u = 0; u < numLuts; u++)
+    {
+        if (partner[u] != -1)
+            continue;
+        const int *uNets = index.lutNets.data() + index.lutNetStart[u];
+        int numUNets = index.lutNetStart[u + 1] - index.lutNetStart[u];
+        bool augmented = false;
+        for (int k = 0; k < numUNets && !augmented; k++)
+        {
+            int net = uNets[k];
+            for (int p = index.netLutStart[net]; p < index.netLutStart[net + 1] && !augmented; p++)
+            {
+                int a = index.netLuts[p];
+                int b = partner[a];
+                if (a == u || b == -1 || pairSharedNets(index, u, a) == -1)
+                    continue;
+                // u暂时标记为占用，b的候选中不能再选到u
+                claimed[u].store(1, std::memory_order_relaxed);
+                int v = findBestCandidate(index, claimed, b);
+                if (v == -1)
+                {
+                    claimed[u].store(0, std::memory_order_relaxed);
+                    continue;
+                }
+                claimed[v].store(1, std::memory_order_relaxed);
+                partner[u] = a;
+                partner[a] = u;
+                partner[b] = v;
+                partner[v] = b;
+                numAugmented++;
+                augmented = true;
+            }
+        }
+    }
+
+    // 按rank顺序串行写回，LUT组的id与线程无关
+    int numPairs = 0;
+    for (int rank = 0; rank < numLuts; rank++)
+    {
+        int other = partner[rank];
+        if (other == -1 || other < rank)
+            continue;
+        Instance *currentLUT = index.luts[rank];
+        Instance *matchedLUT = index.luts[other];
+        currentLUT->setMatchedLUTID(matchedLUT->getInstID());
+        matchedLUT->setMatchedLUTID(currentLUT->getInstID());
+
+        int newInstanceID = generateNewInstanceID();
+        lutGroups[newInstanceID] = {currentLUT, matchedLUT};
+        currentLUT->setLUTSetID(newInstanceID);
+        matchedLUT->setLUTSetID(newInstanceID);
+        numPairs++;
+    }
+    std::cout << "  Paired " << numPairs << " LUT pairs from " << numLuts << " LUTs in " << numRounds << " rounds, " << numAugmented << " by augmenting" << std::endl;
+    return numPairs;
+}
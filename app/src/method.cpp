@@ -6,8 +6,9 @@
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <future>
+#include <atomic>
 #include "wirelength.h"
+#include "lutpair.h"
 
 #include <thread>
 #include <mutex>
@@ -22,11 +23,7 @@ int generateNewInstanceID()
 }
 
 // 共享数据结构的锁
-std::mutex lutMutex;
-std::unordered_set<int> matchedLUTs; // 存储已匹配的 LUT IDs
 std::mutex seqPlacementMutex;        // 互斥锁保护对 seqPlacementMap 的访问
-std::mutex glbPackNetMapMutex;       // 添加 glbPackNetMapMutex 变量，用于保护 glbPackNetMap 的访问
-std::mutex oldNetIDMutex;            // 用于保护 oldNetID2newNetID 的互斥锁
 
 // LUT组匹配,将剩余未加入LUT组的LUT单独加入新的LUT组——已确定正确
 void populateLUTGroups(std::map<int, Instance *> &glbInstMap)
@@ -503,175 +500,11 @@ void matchLUTPairs11(std::map<int, Instance *> &glbInstMap)
     }
 }
 
-void matchLUTPairsThread(std::map<int, Instance *> &glbInstMap, std::vector<int> &unmatchedLUTs,
-                         std::unordered_map<int, std::unordered_set<int>> &lutNetMap,
-                         std::unordered_map<int, std::unordered_set<int>> &netLUTMap, int start, int end)
-{
-    int wireLimit = 1; // 线长限制，默认为2
-    while (start < end)
-    {
-        int bestMatchedLUTID = -1;
-        int maxSharedNets = -1;
-
-        int currentLUTID = unmatchedLUTs[start];
-        Instance *currentLUT = glbInstMap[currentLUTID];
-
-        int inputPinNum = currentLUT->getUsedNumInpins();
-        {
-            std::lock_guard<std::mutex> lock(lutMutex);
-            if (matchedLUTs.find(currentLUTID) != matchedLUTs.end() && currentLUT->getMatchedLUTID() != -1)
-            {
-                ++start;
-                continue;
-            }
-        }
-
-        const auto &currentLUTNets = lutNetMap[currentLUTID];
-
-        for (int netID : currentLUTNets)
-        {
-            const auto &relatedLUTs = netLUTMap[netID];
-
-            for (int otherLUTID : relatedLUTs)
-            {
-                if (otherLUTID == currentLUTID)
-                    continue;
-
-                Instance *otherLUT = glbInstMap[otherLUTID];
-
-                // 距离限制判断
-                int twoinstwirelength = calculateTwoInstanceWireLength(currentLUT, otherLUT, false);
-                if (twoinstwirelength >= wireLimit)
-                {
-                    continue;
-                }
-
-                {
-                    std::lock_guard<std::mutex> lock(lutMutex);
-                    if (matchedLUTs.find(otherLUTID) != matchedLUTs.end())
-                        continue;
-                }
-
-                // 添加条件：如果两个 LUT 都是固定的，则跳过
-                if (currentLUT->isFixed() && otherLUT->isFixed())
-                    continue;
-
-                const auto &otherLUTNets = lutNetMap[otherLUTID];
-                int sharedNetCount = 0;
-                for (int net : currentLUTNets)
-                {
-                    if (otherLUTNets.find(net) != otherLUTNets.end())
-                    {
-                        sharedNetCount++;
-                    }
-                }
-
-                std::unordered_set<int> unionPins = unionSets(currentLUTNets, otherLUTNets);
-                int totalInpins = unionPins.size();
-
-                // // 完全匹配模式
-                // if (sharedNetCount > maxSharedNets && totalInpins == inputPinNum && currentLUTNets.size() == otherLUTNets.size())
-                // {
-                //     maxSharedNets = sharedNetCount;
-                //     bestMatchedLUTID = otherLUTID;
-                // }
-
-                // 最大匹配模式
-                if (sharedNetCount > maxSharedNets && totalInpins <= 6 && sharedNetCount > 1)
-                {
-                    maxSharedNets = sharedNetCount;
-                    bestMatchedLUTID = otherLUTID;
-                }
-            }
-        }
-
-        if (bestMatchedLUTID != -1)
-        {
-            std::lock_guard<std::mutex> lock(lutMutex);
-            if (matchedLUTs.find(currentLUTID) == matchedLUTs.end() &&
-                matchedLUTs.find(bestMatchedLUTID) == matchedLUTs.end())
-            {
-                matchedLUTs.insert(currentLUTID);
-                matchedLUTs.insert(bestMatchedLUTID);
-
-                // 添加matchedID
-                currentLUT->setMatchedLUTID(bestMatchedLUTID);
-                glbInstMap[bestMatchedLUTID]->setMatchedLUTID(currentLUTID);
-
-                int newInstanceID = generateNewInstanceID();
-                lutGroups[newInstanceID] = {currentLUT, glbInstMap[bestMatchedLUTID]};
-                currentLUT->setLUTSetID(newInstanceID);
-                glbInstMap[bestMatchedLUTID]->setLUTSetID(newInstanceID);
-            }
-        }
-
-        ++start;
-    }
-}
-
 // 打包代码
 void matchLUTPairs(std::map<int, Instance *> &glbInstMap, bool isLutPack, bool isSeqPack)
 {
-    std::unordered_map<int, std::unordered_set<int>> lutNetMap; // LUT ID -> 连接的net ID集合（仅输入引脚）
-    std::unordered_map<int, std::unordered_set<int>> netLUTMap; // Net ID -> 连接到该net的LUT ID集合
-    std::vector<int> unmatchedLUTs;                             // 未匹配的LUT集合
-
-    // 构建 LUT 和 Net 的映射
-
-    for (const auto &instPair : glbInstMap)
-    {
-        int instID = instPair.first;
-        Instance *inst = instPair.second;
-
-        // 跳过类型不是以 "LUT" 开头的实例
-        if (!isLUTType(inst->getModelName()))
-        {
-            continue;
-        }
-
-        // 添加未匹配的LUT
-        unmatchedLUTs.push_back(instID);
-
-        // 遍历当前实例的输入引脚nets
-        for (int i = 0; i < inst->getNumInpins(); ++i)
-        {
-            Pin *pin = inst->getInpin(i);
-            int netID = pin->getNetID();
-
-            // 跳过未连接的引脚或为CLOCK的net
-            if (netID == -1 || pin->getProp() == PIN_PROP_CLOCK)
-            {
-                continue;
-            }
-
-            // 更新 lutNetMap 和 netLUTMap 的映射
-            lutNetMap[instID].insert(netID);
-            netLUTMap[netID].insert(instID);
-        }
-    }
-
-    // 按引脚数量从多到少排序 unmatchedLUTs
-    std::sort(unmatchedLUTs.begin(), unmatchedLUTs.end(), [&](int a, int b)
-              { return glbInstMap[a]->getNumInpins() > glbInstMap[b]->getNumInpins(); });
-
-    // 使用多线程进行匹配
-    const int numThreads = 8;                          // 线程数量
-    int chunkSize = unmatchedLUTs.size() / numThreads; // 每个线程处理的LUT数量
-    std::vector<std::thread> threads;
-
-    for (int i = 0; i < numThreads; ++i)
-    {
-        int start = i * chunkSize;
-        int end = (i == numThreads - 1) ? unmatchedLUTs.size() : (i + 1) * chunkSize;
-
-        threads.emplace_back(matchLUTPairsThread, std::ref(glbInstMap), std::ref(unmatchedLUTs),
-                             std::ref(lutNetMap), std::ref(netLUTMap), start, end);
-    }
+    pairLUTs(glbInstMap);
 
-    for (auto &t : threads)
-    {
-        t.join(); // 等待所有线程完成
-    }
     if (isLutPack)
     {
         populateLUTGroups(glbInstMap);
@@ -694,7 +527,6 @@ void matchLUTPairs(std::map<int, Instance *> &glbInstMap, bool isLutPack, bool i
 
     // 执行要测量的函数
     initialGlbPackNetMap();
-    // initialGlbPackNetMap_multi_thread();
 
     // 获取结束时间点
     auto end = std::chrono::high_resolution_clock::now();
@@ -2253,40 +2085,101 @@ void initialGlbPackInstMap(bool isSeqPack)
     }
 }
 
+// 生成打包后的net，与逐个net串行处理的结果相同
+// 1、先数出需要保留的net（driver所在inst有映射），前缀和得到每个net的新netID
+// 2、各线程按批次领取net，写入预分配数组中自己的位置，不需要加锁
+// 3、sink按打包inst去重，每个线程一个按instID索引的标记数组，标记值为net下标，不用每次清空
 void initialGlbPackNetMap()
 {
     std::cout << " --- 生成新的glbPackNetMap ---" << std::endl;
-    int newNetPackID = 0;
-    for (auto iter : glbNetMap)
+    std::vector<std::pair<int, Net *>> nets(glbNetMap.begin(), glbNetMap.end());
+    int numNets = nets.size();
+
+    // 每个inst对应的打包inst，先串行求出，并行时只读
+    int maxInstID = glbInstMap.empty() ? -1 : glbInstMap.rbegin()->first;
+    std::vector<Instance *> packInstOf(maxInstID + 1, nullptr);
+    for (auto &entry : glbInstMap)
     {
-        auto netID = iter.first;
-        auto net = iter.second;
-        oldNetID2newNetID.insert(std::make_pair(netID, newNetPackID)); // 建立旧netID到新netID的映射
-        // 处理InPin
-        auto currentInPin = net->getInpin();
-        if (currentInPin->getInstanceOwner()->getMapInstID().size() == 0)
-        {
-            continue;
-        }
+        packInstOf[entry.first] = entry.second->getPackInstance();
+    }
 
-        Pin *newInPin = new Pin(newNetPackID, currentInPin->getProp(), currentInPin->getTimingCritical(), nullptr);
-        newInPin->setInstanceOwner(currentInPin->getInstanceOwner()->getPackInstance());
+    // newNetPackID[i]为第i个net之前保留的net数，未保留的net也映射到这个值
+    std::vector<int> newNetPackID(numNets + 1, 0);
+    for (int i = 0; i < numNets; i++)
+    {
+        bool keep = nets[i].second->getInpin()->getInstanceOwner()->getMapInstID().size() != 0;
+        newNetPackID[i + 1] = newNetPackID[i] + (keep ? 1 : 0);
+    }
+    int numPackNets = newNetPackID[numNets];
+
+    int maxNetID = nets.empty() ? -1 : nets.back().first;
+    oldNetID2newNetID.assign(maxNetID + 1, -1);
+    for (int i = 0; i < numNets; i++)
+    {
+        oldNetID2newNetID[nets[i].first] = newNetPackID[i];
+    }
 
-        Net *newNet = new Net(newNetPackID);
-        newNet->setClock(net->isClock());
-        newNet->setInpin(newInPin);
-        for (auto currentOutPin : net->getOutputPins())
+    std::vector<Net *> packNets(numPackNets, nullptr);
+    const int batchSize = 256;
+    std::atomic<int> next(0);
+    auto worker = [&]()
+    {
+        std::vector<int> visitedNet(maxInstID + 1, -1);
+        while (true)
         {
-            Pin *newOutPin = new Pin(newNetPackID, currentOutPin->getProp(), currentOutPin->getTimingCritical(), nullptr);
-            newOutPin->setInstanceOwner(currentOutPin->getInstanceOwner()->getPackInstance());
-            newNet->addPinIfUnique(newOutPin);
-            // auto inst = pin->getInstanceOwner();
-            int a = 0;
+            int begin = next.fetch_add(batchSize);
+            if (begin >= numNets)
+                break;
+            int end = std::min(numNets, begin + batchSize);
+            for (int i = begin; i < end; i++)
+            {
+                if (newNetPackID[i + 1] == newNetPackID[i])
+                    continue;
+                int packID = newNetPackID[i];
+                Net *net = nets[i].second;
+                auto currentInPin = net->getInpin();
+                Pin *newInPin = new Pin(packID, currentInPin->getProp(), currentInPin->getTimingCritical(), nullptr);
+                newInPin->setInstanceOwner(packInstOf[currentInPin->getInstanceOwner()->getInstID()]);
+
+                Net *newNet = new Net(packID);
+                newNet->setClock(net->isClock());
+                newNet->setInpin(newInPin);
+                for (auto currentOutPin : net->getOutputPins())
+                {
+                    // 同一个打包inst只保留第一个sink
+                    Instance *packInst = packInstOf[currentOutPin->getInstanceOwner()->getInstID()];
+                    int &visited = visitedNet[packInst->getInstID()];
+                    if (visited == i)
+                        continue;
+                    visited = i;
+                    Pin *newOutPin = new Pin(packID, currentOutPin->getProp(), currentOutPin->getTimingCritical(), nullptr);
+                    newOutPin->setInstanceOwner(packInst);
+                    newNet->addOutputPin(newOutPin);
+                }
+                packNets[packID] = newNet;
+            }
         }
+    };
+    int numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+    {
+        numThreads = 4;
+    }
+    numThreads = std::max(1, std::min(numThreads, (numNets + batchSize - 1) / batchSize));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
 
-        glbPackNetMap.insert(std::make_pair(newNetPackID, newNet));
-        newNetPackID++;
-        int a = 0;
+    for (int packID = 0; packID < numPackNets; packID++)
+    {
+        glbPackNetMap.emplace_hint(glbPackNetMap.end(), packID, packNets[packID]);
     }
 }
 
@@ -2342,77 +2235,6 @@ void recoverAllMap(bool isSeqPack)
     }
 }
 
-void processNet(int netID, Net *net, int &newNetPackID)
-{
-    {
-        std::lock_guard<std::mutex> lock(oldNetIDMutex); // 用互斥锁保护 oldNetID2newNetID 的访问
-        oldNetID2newNetID.insert(std::make_pair(netID, newNetPackID));
-    }
-
-    auto currentInPin = net->getInpin();
-    if (currentInPin->getInstanceOwner()->getMapInstID().size() == 0)
-    {
-        return;
-    }
-
-    Pin *newInPin = new Pin(newNetPackID, currentInPin->getProp(), currentInPin->getTimingCritical(), nullptr);
-    newInPin->setInstanceOwner(currentInPin->getInstanceOwner()->getPackInstance());
-
-    Net *newNet = new Net(newNetPackID);
-    newNet->setClock(net->isClock());
-    newNet->setInpin(newInPin);
-
-    for (auto currentOutPin : net->getOutputPins())
-    {
-        Pin *newOutPin = new Pin(newNetPackID, currentOutPin->getProp(), currentOutPin->getTimingCritical(), nullptr);
-        newOutPin->setInstanceOwner(currentOutPin->getInstanceOwner()->getPackInstance());
-        newNet->addPinIfUnique(newOutPin);
-    }
-
-    {
-        std::lock_guard<std::mutex> lock(glbPackNetMapMutex); // 使用互斥锁保护对 glbPackNetMap 的访问
-        glbPackNetMap.insert(std::make_pair(newNetPackID, newNet));
-        newNetPackID++;
-    }
-}
-
-void initialGlbPackNetMap_multi_thread()
-{
-    std::cout << " --- 生成新的 glbPackNetMap ---" << std::endl;
-
-    // 获取系统的硬件线程数
-    unsigned int numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0)
-        numThreads = 8; // 如果无法检测到核心数，使用 8 作为默认值
-
-    // 使用线程池限制线程数量
-    std::vector<std::future<void>> futures;
-    int newNetPackID = 0;
-
-    for (auto iter : glbNetMap)
-    {
-        int netID = iter.first;
-        Net *net = iter.second;
-
-        // 将任务加入线程池
-        if (futures.size() >= numThreads)
-        {
-            for (auto &f : futures)
-            {
-                f.wait(); // 等待当前的任务完成
-            }
-            futures.clear();
-        }
-
-        futures.push_back(std::async(std::launch::async, processNet, netID, net, std::ref(newNetPackID)));
-    }
-
-    // 等待所有任务完成
-    for (auto &f : futures)
-    {
-        f.wait();
-    }
-}
 //提取node文件名
 std::string extractFileName(const std::string& filePath) {
     size_t pos = filePath.find_last_of("/\\"); // 查找最后一个路径分隔符的位置
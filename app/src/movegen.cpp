@@ -0,0 +1,74 @@
+#include "movegen.h"
+
+MoveGenerator glbMoveGen;
+
+void MoveGenerator::clear()
+{
+    flat = nullptr;
+    movableStart.clear();
+    movableInsts.clear();
+    centers.clear();
+    centerValid.clear();
+}
+
+void MoveGenerator::build(const FlatNetlist &flat, bool isBaseline)
+{
+    clear();
+    this->flat = &flat;
+    this->isBaseline = isBaseline;
+
+    int numNets = flat.getNumNets();
+    movableStart.reserve(numNets + 1);
+    movableStart.push_back(0);
+    for (int n = 0; n < numNets; n++)
+    {
+        for (const int *p = flat.getPinInstsBegin(n); p != flat.getPinInstsEnd(n); ++p)
+        {
+            if (!flat.getInst(*p)->isFixed())
+            {
+                movableInsts.push_back(*p);
+            }
+        }
+        movableStart.push_back(movableInsts.size());
+    }
+    centers.assign(numNets, std::make_pair(0, 0));
+    centerValid.assign(numNets, 0);
+}
+
+Instance *MoveGenerator::selectInst(int netIdx, std::mt19937 &rng) const
+{
+    if (netIdx < 0)
+    {
+        return nullptr;
+    }
+    int begin = movableStart[netIdx], end = movableStart[netIdx + 1];
+    if (begin == end)
+    {
+        return nullptr;
+    }
+    std::uniform_int_distribution<int> dist(begin, end - 1);
+    return flat->getInst(movableInsts[dist(rng)]);
+}
+
+std::pair<int, int> MoveGenerator::getNetCenter(int netIdx)
+{
+    if (!centerValid[netIdx])
+    {
+        centers[netIdx] = flat->getNetCenter(netIdx, isBaseline);
+        centerValid[netIdx] = 1;
+    }
+    return centers[netIdx];
+}
+
+void MoveGenerator::instMoved(Instance *inst)
+{
+    int instIdx = flat->getInstIndex(inst);
+    if (instIdx == -1)
+    {
+        return;
+    }
+    for (const int *n = flat->getInstNetsBegin(instIdx); n != flat->getInstNetsEnd(instIdx); ++n)
+    {
+        centerValid[*n] = 0;
+    }
+}
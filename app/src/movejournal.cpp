@@ -0,0 +1,162 @@
+#include "global.h"
+#include "movejournal.h"
+#include "freesite.h"
+#include "tilepin.h"
+#include "util.h"
+
+void MoveJournal::setLocation(Instance *inst, const std::tuple<int, int, int> &loc)
+{
+    Entry entry = {};
+    entry.type = ENTRY_LOCATION;
+    entry.inst = inst;
+    if (isBaseline)
+    {
+        entry.loc = inst->getBaseLocation();
+        inst->setBaseLocation(loc);
+    }
+    else
+    {
+        entry.loc = inst->getLocation();
+        inst->setLocation(loc);
+    }
+    entries.push_back(entry);
+}
+
+void MoveJournal::addInstance(Tile *tile, Instance *typeInst, int instID, int offset)
+{
+    if (!tile->addInstance(instID, offset, typeInst->getModelName(), isBaseline))
+    {
+        return;
+    }
+    Entry entry = {};
+    entry.type = ENTRY_SLOT_ADD;
+    entry.inst = typeInst;
+    entry.tile = tile;
+    entry.instID = instID;
+    entry.offset = offset;
+    entries.push_back(entry);
+}
+
+void MoveJournal::removeInstance(Tile *tile, Instance *typeInst, int instID, int offset)
+{
+    std::string modelType = typeInst->getModelName();
+    slotArr *slots = tile->getInstanceByType(unifyModelType(modelType));
+    if (slots == nullptr || offset >= (int)slots->size())
+    {
+        return;
+    }
+    const SlotInstances &instances = (*slots)[offset]->getInstances(isBaseline);
+    int pos = 0;
+    while (pos < (int)instances.size() && instances[pos] != instID)
+    {
+        pos++;
+    }
+    if (pos == (int)instances.size())
+    {
+        return;
+    }
+    tile->removeInstanceAt(instID, offset, modelType, isBaseline);
+    Entry entry = {};
+    entry.type = ENTRY_SLOT_REMOVE;
+    entry.inst = typeInst;
+    entry.tile = tile;
+    entry.instID = instID;
+    entry.offset = offset;
+    entry.pos = pos;
+    entries.push_back(entry);
+}
+
+void MoveJournal::moveTilePin(Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc)
+{
+    glbTilePinCounter.moveInstance(isBaseline, inst, originLoc, loc);
+    Entry entry = {};
+    entry.type = ENTRY_TILE_PIN;
+    entry.inst = inst;
+    entry.loc = originLoc;
+    entry.loc2 = loc;
+    entries.push_back(entry);
+}
+
+void MoveJournal::changeTile(Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc)
+{
+    int xCur, yCur, zCur, xGoal, yGoal, zGoal;
+    std::tie(xCur, yCur, zCur) = originLoc;
+    std::tie(xGoal, yGoal, zGoal) = loc;
+    Tile *tileCur = chip.getTile(xCur, yCur);
+    Tile *tileGoal = chip.getTile(xGoal, yGoal);
+    int instId = inst->getInstID();
+    Instance *matchedInst = nullptr;
+    if (inst->getMatchedLUTID() != -1)
+    {
+        matchedInst = glbInstMap[inst->getMatchedLUTID()];
+    }
+    if (matchedInst != nullptr && inst->getModelName().compare(0, 3, "LUT") == 0)
+    {
+        // 配对的LUT一起移动，清空原slot，从后往前删，撤销时从前往后插回
+        slotArr *slots = tileCur->getInstanceByType("LUT");
+        if (slots != nullptr && zCur < (int)slots->size())
+        {
+            const SlotInstances &instances = (*slots)[zCur]->getInstances(isBaseline);
+            while (!instances.empty())
+            {
+                removeInstance(tileCur, inst, instances[instances.size() - 1], zCur);
+            }
+        }
+        addInstance(tileGoal, inst, instId, zGoal);
+        addInstance(tileGoal, inst, inst->getMatchedLUTID(), zGoal);
+    }
+    else
+    {
+        // 删除旧的tile插槽中的inst，在新的插槽中插入
+        removeInstance(tileCur, inst, instId, zCur);
+        addInstance(tileGoal, inst, instId, zGoal);
+    }
+    glbFreeSiteIndex.updateTile(xCur, yCur);
+    glbFreeSiteIndex.updateTile(xGoal, yGoal);
+    moveTilePin(inst, originLoc, loc);
+    if (matchedInst != nullptr)
+    {
+        moveTilePin(matchedInst, originLoc, loc);
+    }
+}
+
+void MoveJournal::rollback()
+{
+    bool tileChanged = false;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        const Entry &entry = *it;
+        switch (entry.type)
+        {
+        case ENTRY_LOCATION:
+            if (isBaseline)
+                entry.inst->setBaseLocation(entry.loc);
+            else
+                entry.inst->setLocation(entry.loc);
+            break;
+        case ENTRY_SLOT_ADD:
+            entry.tile->removeInstanceAt(entry.instID, entry.offset, entry.inst->getModelName(), isBaseline);
+            tileChanged = true;
+            break;
+        case ENTRY_SLOT_REMOVE:
+            entry.tile->insertInstanceAt(entry.instID, entry.offset, entry.pos, entry.inst->getModelName(), isBaseline);
+            tileChanged = true;
+            break;
+        case ENTRY_TILE_PIN:
+            glbTilePinCounter.moveInstance(isBaseline, entry.inst, entry.loc2, entry.loc);
+            break;
+        }
+    }
+    // slot都复原之后再更新空闲位置索引
+    if (tileChanged)
+    {
+        for (const Entry &entry : entries)
+        {
+            if (entry.type == ENTRY_SLOT_ADD || entry.type == ENTRY_SLOT_REMOVE)
+            {
+                glbFreeSiteIndex.updateTile(entry.tile->getCol(), entry.tile->getRow());
+            }
+        }
+    }
+    entries.clear();
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <iostream>
+#include "global.h"
+#include "netbbox.h"
+
+NetBBoxEngine glbNetBBox;
+
+void NetBBoxEngine::scanNet(Net *net, NetBBox &box) const
+{
+    // driver先初始化边界，之后依次加入sink
+    int x, y, z;
+    Instance *driver = net->getInpin()->getInstanceOwner();
+    std::tie(x, y, z) = isBaseline ? driver->getBaseLocation() : driver->getLocation();
+    box.xMin = box.xMax = x;
+    box.yMin = box.yMax = y;
+    box.xMinCnt = box.xMaxCnt = box.yMinCnt = box.yMaxCnt = 1;
+    for (Pin *pin : net->getOutputPins())
+    {
+        Instance *inst = pin->getInstanceOwner();
+        std::tie(x, y, z) = isBaseline ? inst->getBaseLocation() : inst->getLocation();
+        if (x < box.xMin)
+        {
+            box.xMin = x;
+            box.xMinCnt = 0;
+        }
+        if (x > box.xMax)
+        {
+            box.xMax = x;
+            box.xMaxCnt = 0;
+        }
+        if (y < box.yMin)
+        {
+            box.yMin = y;
+            box.yMinCnt = 0;
+        }
+        if (y > box.yMax)
+        {
+            box.yMax = y;
+            box.yMaxCnt = 0;
+        }
+        if (x == box.xMin)
+            box.xMinCnt++;
+        if (x == box.xMax)
+            box.xMaxCnt++;
+        if (y == box.yMin)
+            box.yMinCnt++;
+        if (y == box.yMax)
+            box.yMaxCnt++;
+    }
+}
+
+void NetBBoxEngine::build(std::map<int, Net *> &netMap, bool isBaseline)
+{
+    this->isBaseline = isBaseline;
+    totalHPWL = 0;
+    nets.clear();
+    boxes.clear();
+    netIndex.clear();
+    instPinStart.clear();
+    instPinNet.clear();
+    instPinCount.clear();
+    pending.clear();
+    pendingPins.clear();
+    pendingDelta = 0;
+
+    // 先按net收集(instID, net下标, pin数)，同一net内用lastNet合并同一inst的pin
+    std::vector<int> entryInst, entryNet, entryCount;
+    std::vector<int> lastNet, lastEntry;
+    int numInsts = 0;
+    bool valid = true;
+    auto addPin = [&](Instance *inst, int idx) {
+        int id = inst->getInstID();
+        if (id < 0)
+        {
+            valid = false;
+            return;
+        }
+        if (id >= (int)lastNet.size())
+        {
+            lastNet.resize(id + 1, -1);
+            lastEntry.resize(id + 1, -1);
+        }
+        numInsts = std::max(numInsts, id + 1);
+        if (lastNet[id] == idx)
+        {
+            entryCount[lastEntry[id]]++;
+            return;
+        }
+        lastNet[id] = idx;
+        lastEntry[id] = entryInst.size();
+        entryInst.push_back(id);
+        entryNet.push_back(idx);
+        entryCount.push_back(1);
+    };
+    for (auto &iter : netMap)
+    {
+        Net *net = iter.second;
+        if (net->isClock() || net->getInpin() == nullptr)
+        {
+            continue;
+        }
+        int idx = nets.size();
+        netIndex[iter.first] = idx;
+        nets.push_back(net);
+        NetBBox box;
+        scanNet(net, box);
+        boxes.push_back(box);
+        totalHPWL += box.getHPWL();
+
+        addPin(net->getInpin()->getInstanceOwner(), idx);
+        for (Pin *pin : net->getOutputPins())
+        {
+            addPin(pin->getInstanceOwner(), idx);
+        }
+    }
+    if (!valid)
+    {
+        std::cout << "Error: instance without ID found when building net bounding boxes" << std::endl;
+    }
+
+    // 按instID计数排序成CSR，每个inst内net下标升序
+    instPinStart.assign(numInsts + 1, 0);
+    for (int id : entryInst)
+    {
+        instPinStart[id + 1]++;
+    }
+    for (int i = 0; i < numInsts; i++)
+    {
+        instPinStart[i + 1] += instPinStart[i];
+    }
+    instPinNet.resize(entryInst.size());
+    instPinCount.resize(entryInst.size());
+    std::vector<int> fill(instPinStart.begin(), instPinStart.end() - 1);
+    for (int e = 0; e < (int)entryInst.size(); e++)
+    {
+        int pos = fill[entryInst[e]]++;
+        instPinNet[pos] = entryNet[e];
+        instPinCount[pos] = entryCount[e];
+    }
+    netMark.assign(nets.size(), 0);
+    netSlot.assign(nets.size(), -1);
+    epoch = 0;
+}
+
+int NetBBoxEngine::getNetHPWL(int netId) const
+{
+    auto it = netIndex.find(netId);
+    if (it == netIndex.end())
+    {
+        return 0;
+    }
+    return boxes[it->second].getHPWL();
+}
+
+// k个pin从vOld移到vNew，返回false表示需要重新扫描
+bool NetBBoxEngine::updateAxis(int &vMin, int &vMax, int &minCnt, int &maxCnt, int vOld, int vNew, int k) const
+{
+    if (vNew > vOld)
+    {
+        if (vOld == vMin)
+        {
+            if (minCnt == k)
+                return false; // 最后的pin离开了下边
+            minCnt -= k;
+        }
+        if (vNew > vMax)
+        {
+            vMax = vNew;
+            maxCnt = k;
+        }
+        else if (vNew == vMax)
+        {
+            maxCnt += k;
+        }
+    }
+    else if (vNew < vOld)
+    {
+        if (vOld == vMax)
+        {
+            if (maxCnt == k)
+                return false; // 最后的pin离开了上边
+            maxCnt -= k;
+        }
+        if (vNew < vMin)
+        {
+            vMin = vNew;
+            minCnt = k;
+        }
+        else if (vNew == vMin)
+        {
+            minCnt += k;
+        }
+    }
+    return true;
+}
+
+int NetBBoxEngine::evalMove(const Instance *const *movedInsts, int numInsts, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc)
+{
+    pending.clear();
+    pendingPins.clear();
+    pendingDelta = 0;
+    int xOld = std::get<0>(originLoc), yOld = std::get<1>(originLoc);
+    int xNew = std::get<0>(loc), yNew = std::get<1>(loc);
+    if (xOld == xNew && yOld == yNew)
+    {
+        return 0;
+    }
+    // 合并多个inst在同一net上的pin数
+    if (++epoch == 0)
+    {
+        std::fill(netMark.begin(), netMark.end(), 0);
+        epoch = 1;
+    }
+    for (int i = 0; i < numInsts; i++)
+    {
+        int id = movedInsts[i]->getInstID();
+        if (id < 0 || id + 1 >= (int)instPinStart.size())
+            continue;
+        for (int p = instPinStart[id]; p < instPinStart[id + 1]; p++)
+        {
+            int idx = instPinNet[p];
+            if (netMark[idx] == epoch)
+            {
+                pendingPins[netSlot[idx]] += instPinCount[p];
+                continue;
+            }
+            netMark[idx] = epoch;
+            netSlot[idx] = pending.size();
+            pending.emplace_back(idx, boxes[idx]);
+            pendingPins.push_back(instPinCount[p]);
+        }
+    }
+    for (int i = 0; i < (int)pending.size(); i++)
+    {
+        int idx = pending[i].first;
+        NetBBox &box = pending[i].second;
+        int k = pendingPins[i];
+        bool ok = updateAxis(box.xMin, box.xMax, box.xMinCnt, box.xMaxCnt, xOld, xNew, k) &&
+                  updateAxis(box.yMin, box.yMax, box.yMinCnt, box.yMaxCnt, yOld, yNew, k);
+        if (!ok)
+        {
+            // inst位置已经修改，直接重新扫描
+            scanNet(nets[idx], box);
+        }
+        pendingDelta += box.getHPWL() - boxes[idx].getHPWL();
+    }
+    return pendingDelta;
+}
+
+void NetBBoxEngine::commitMove()
+{
+    for (auto &it : pending)
+    {
+        boxes[it.first] = it.second;
+    }
+    totalHPWL += pendingDelta;
+    pending.clear();
+    pendingDelta = 0;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include "netfitness.h"
+
+void NetFitness::clear()
+{
+    flat = nullptr;
+    state = nullptr;
+    actual.clear();
+    desired.clear();
+    desiredEpoch.clear();
+    epoch = 0;
+    fitness.clear();
+    bucket.clear();
+    order.clear();
+    posOf.clear();
+    bucketStart.clear();
+}
+
+float NetFitness::calculFitness(int rangeDesired, int rangeActual)
+{
+    if (rangeDesired == 0 && rangeActual == 0)
+    {
+        return 1; // 都为0则不考虑移动了，认为为最完美的net
+    }
+    else if (rangeDesired >= rangeActual)
+    {
+        return rangeActual / rangeDesired;
+    }
+    else
+    {
+        return rangeDesired / rangeActual;
+    }
+}
+
+int NetFitness::bucketOf(float fitness)
+{
+    int b = fitness * NUM_BUCKETS;
+    return std::max(0, std::min(NUM_BUCKETS - 1, b));
+}
+
+void NetFitness::build(const FlatNetlist &flat, const PlacementState &state)
+{
+    std::vector<int> nets(flat.getNumNets());
+    for (int i = 0; i < (int)nets.size(); i++)
+    {
+        nets[i] = i;
+    }
+    build(flat, state, nets);
+}
+
+void NetFitness::build(const FlatNetlist &flat, const PlacementState &state, const std::vector<int> &nets)
+{
+    clear();
+    this->flat = &flat;
+    this->state = &state;
+    int n = flat.getNumNets();
+
+    actual.assign(n, 0);
+    for (int i : nets)
+    {
+        actual[i] = flat.getNetHPWL(i, state) / 2;
+    }
+    desired = actual;
+    desiredEpoch.assign(n, epoch);
+
+    // 按桶计数排序，桶内保持nets中的顺序
+    fitness.assign(n, 0);
+    bucket.assign(n, 0);
+    bucketStart.assign(NUM_BUCKETS + 1, 0);
+    for (int i : nets)
+    {
+        fitness[i] = calculFitness(desired[i], actual[i]);
+        bucket[i] = bucketOf(fitness[i]);
+        bucketStart[bucket[i] + 1]++;
+    }
+    for (int b = 0; b < NUM_BUCKETS; b++)
+    {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    order.resize(nets.size());
+    posOf.assign(n, -1);
+    std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (int i : nets)
+    {
+        int pos = fill[bucket[i]]++;
+        order[pos] = i;
+        posOf[i] = pos;
+    }
+}
+
+int NetFitness::sampleNet(std::mt19937 &rng) const
+{
+    std::uniform_int_distribution<int> dist(0, order.size() - 1);
+    int a = dist(rng);
+    int b = dist(rng);
+    return order[std::min(a, b)];
+}
+
+void NetFitness::updateNet(int netIdx)
+{
+    if (posOf[netIdx] == -1)
+    {
+        return;
+    }
+    if (desiredEpoch[netIdx] != epoch)
+    {
+        // 提升之后第一次修改，先把提升时的值留给desired
+        desired[netIdx] = actual[netIdx];
+        desiredEpoch[netIdx] = epoch;
+    }
+    actual[netIdx] = flat->getNetHPWL(netIdx, *state) / 2;
+    fitness[netIdx] = calculFitness(desired[netIdx], actual[netIdx]);
+    moveToBucket(netIdx, bucketOf(fitness[netIdx]));
+}
+
+void NetFitness::moveToBucket(int netIdx, int target)
+{
+    int pos = posOf[netIdx];
+    int b = bucket[netIdx];
+    // 每跨过一个桶，与该桶边界上的元素交换，然后移动边界
+    while (b < target)
+    {
+        int last = bucketStart[b + 1] - 1;
+        int other = order[last];
+        order[pos] = other;
+        posOf[other] = pos;
+        pos = last;
+        bucketStart[b + 1]--;
+        b++;
+    }
+    while (b > target)
+    {
+        int first = bucketStart[b];
+        int other = order[first];
+        order[pos] = other;
+        posOf[other] = pos;
+        pos = first;
+        bucketStart[b]++;
+        b--;
+    }
+    order[pos] = netIdx;
+    posOf[netIdx] = pos;
+    bucket[netIdx] = target;
+}
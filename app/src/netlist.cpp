@@ -2,6 +2,8 @@
 #include "netlist.h"
 #include "global.h"
 #include "util.h"
+#include <cstring>
+#include <thread>
 
 bool readInputTiming(const std::string& fileName) {
   std::ifstream inputFile(fileName);
@@ -83,8 +85,8 @@ bool readInputTiming(const std::string& fileName) {
 
 bool readInputNodes(const std::string& fileName) {
   // Implementation of readInputNetlist function
-  std::ifstream inputFile(fileName);
-  if (!inputFile.is_open()) {
+  MappedFile inputFile(fileName);
+  if (!inputFile.isOpen()) {
     std::cout << "Failed to open file: " << fileName << std::endl;
     return false;
   }
@@ -98,51 +100,46 @@ bool readInputNodes(const std::string& fileName) {
     }
   }
 
-  // Parse the location string to extract the coordinates
-  std::regex locationRegex("X(\\d+)Y(\\d+)Z(\\d+)");
-
-  std::string line;    
+  // 直接在映射的内存上逐行扫描，每行为 location type name [FIXED]
+  const char* cur = inputFile.begin();
+  const char* end = inputFile.end();
+  const char* lineBegin;
+  const char* lineEnd;
   int errCnt = 0;
-  while (std::getline(inputFile, line)) {        
-    if (line.empty() || line[0] == '#') {
+  while (nextLine(cur, end, lineBegin, lineEnd)) {        
+    if (lineBegin == lineEnd || lineBegin[0] == '#') {
       continue;
     }
-    std::istringstream iss(line);
-    std::string location, type, name;
-    bool isFixed = false;
-    
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-      tokens.push_back(token);
+    const char* tokens[4][2];
+    int numTokens = 0;
+    const char* p = lineBegin;
+    while (numTokens < 4 && nextToken(p, lineEnd, tokens[numTokens][0], tokens[numTokens][1])) {
+      numTokens++;
     }
-    
-    location = tokens[0];
-    type = tokens[1];
-    name = tokens[2];
-    if (tokens.size() == 4) {
-      isFixed = (tokens[3] == "FIXED");
+    if (numTokens < 3) {
+      if (numTokens > 0) {
+        std::cout << "Error: Invalid format of " << std::string(lineBegin, lineEnd) << std::endl;
+        errCnt++;
+      }
+      continue;
+    }
+
+    std::string type(tokens[1][0], tokens[1][1]);
+    std::string name(tokens[2][0], tokens[2][1]);
+    bool isFixed = false;
+    if (numTokens == 4) {
+      isFixed = std::string(tokens[3][0], tokens[3][1]) == "FIXED";
     } 
 
-    std::smatch match;
     int x, y, z;
-    if (std::regex_search(location, match, locationRegex)) {
-      x = std::stoi(match[1]);
-      y = std::stoi(match[2]);
-      z = std::stoi(match[3]);
-    } else {
-      std::cout << "Error: Invalid location format: " << location << std::endl;
+    if (!parseLocationXYZ(tokens[0][0], tokens[0][1], x, y, z)) {
+      std::cout << "Error: Invalid location format: " << std::string(tokens[0][0], tokens[0][1]) << std::endl;
       errCnt++;
+      continue;
     }
 
     int instID = -1;
-    size_t underscorePos = name.find('_');
-    if (underscorePos != std::string::npos) {
-      std::string subStr = name.substr(underscorePos + 1);
-      // Convert the second substring to an integer
-      instID = std::stoi(subStr);
-
-    } else {
+    if (!parseIDAfterUnderscore(tokens[2][0], tokens[2][1], instID)) {
       std::cout << "Error: Invalid name format: " << name << std::endl;
       errCnt++;
     }
@@ -185,7 +182,6 @@ bool readInputNodes(const std::string& fileName) {
       } 
     }
   }
-  inputFile.close();
 
   if (errCnt > 0) {
     return false;
@@ -196,8 +192,8 @@ bool readInputNodes(const std::string& fileName) {
 
 bool readOutputNetlist(const std::string& fileName) {
   // Implementation of readInputNetlist function
-  std::ifstream inputFile(fileName);
-  if (!inputFile.is_open()) {
+  MappedFile inputFile(fileName);
+  if (!inputFile.isOpen()) {
     std::cout << "Failed to open file: " << fileName << std::endl;
     return false;
   }
@@ -210,55 +206,48 @@ bool readOutputNetlist(const std::string& fileName) {
     }
   }
 
-  // Parse the location string to extract the coordinates
-  std::regex locationRegex("X(\\d+)Y(\\d+)Z(\\d+)");
-
-  std::string line;
+  const char* cur = inputFile.begin();
+  const char* end = inputFile.end();
+  const char* lineBegin;
+  const char* lineEnd;
   int errCnt = 0;
-  while (std::getline(inputFile, line)) {
+  while (nextLine(cur, end, lineBegin, lineEnd)) {
     //lineCnt++;
-    if (line.empty() || line[0] == '#') {
+    if (lineBegin == lineEnd || lineBegin[0] == '#') {
       continue;
     }
-
-    std::istringstream iss(line);
-
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-      tokens.push_back(token);
+    const char* tokens[3][2];
+    int numTokens = 0;
+    const char* p = lineBegin;
+    while (numTokens < 3 && nextToken(p, lineEnd, tokens[numTokens][0], tokens[numTokens][1])) {
+      numTokens++;
     }
-    
-    std::string location = tokens[0];
-    std::string type = tokens[1];
-    std::string name = tokens[2];
+    if (numTokens < 3) {
+      if (numTokens > 0) {
+        std::cout << "Error, Invalid format of " << std::string(lineBegin, lineEnd) << std::endl;
+        errCnt++;
+      }
+      continue;
+    }
+    std::string type(tokens[1][0], tokens[1][1]);
 
     int instID = -1;
-    size_t underscorePos = name.find('_');
-    if (underscorePos != std::string::npos) {
-      std::string subStr = name.substr(underscorePos + 1);
-      // Convert the second substring to an integer
-      instID = std::stoi(subStr);
-    } else {
-      std::cout << "Error, Invalid name format: " << name << std::endl;
+    if (!parseIDAfterUnderscore(tokens[2][0], tokens[2][1], instID)) {
+      std::cout << "Error, Invalid name format: " << std::string(tokens[2][0], tokens[2][1]) << std::endl;
       errCnt++;
     }
 
-    std::smatch match;
     int x, y, z;
-    if (std::regex_search(location, match, locationRegex)) {
-      x = std::stoi(match[1]);
-      y = std::stoi(match[2]);
-      z = std::stoi(match[3]);
-    } else {
-      std::cout << "Error, Invalid location format: " << location << std::endl;
+    if (!parseLocationXYZ(tokens[0][0], tokens[0][1], x, y, z)) {
+      std::cout << "Error, Invalid location format: " << std::string(tokens[0][0], tokens[0][1]) << std::endl;
       errCnt++;
+      continue;
     }
 
     // Check if the instance already exists in the map
     auto mIt = glbInstMap.find(instID);
     if (mIt == glbInstMap.end()) {
-      std::cout << "Error, Instance with name " << name << " can not be indexed." << std::endl;
+      std::cout << "Error, Instance with name " << std::string(tokens[2][0], tokens[2][1]) << " can not be indexed." << std::endl;
       errCnt++;
       continue; // Skip adding the instance to the map
     }
@@ -269,12 +258,11 @@ bool readOutputNetlist(const std::string& fileName) {
     if (tilePtr != nullptr) {
       // add optimized coordinate
       if (tilePtr->addInstance(instID, z, type, false) == false) {
-        std::cout << "Error: Failed to add optimized coordinate for instance " << name << std::endl;
+        std::cout << "Error: Failed to add optimized coordinate for instance " << mIt->second->getInstanceName() << std::endl;
         return false;
       } 
     }
   }
-  inputFile.close();
 
   int totalCnt = glbInstMap.size();
   int fixedCnt = 0;
@@ -325,85 +313,210 @@ bool readOutputNetlist(const std::string& fileName) {
   }
 }
 
-bool readInputNets(const std::string& fileName) {
-  std::ifstream inputFile(fileName);
-  if (!inputFile.is_open()) {
-    std::cout << "Failed to open file: " << fileName << std::endl;
+// 一个net块的解析结果，pin的netID在合并时按文件顺序写入
+struct ParsedNet {
+  Net* net = nullptr;
+  std::vector<Pin*> pins;
+  std::string messages; // 解析时的报错信息，合并时按顺序输出
+  int numErr = 0;
+};
+
+static bool startsWith(const char* begin, const char* end, const char* prefix) {
+  size_t len = strlen(prefix);
+  return (size_t)(end - begin) >= len && memcmp(begin, prefix, len) == 0;
+}
+
+// 解析pin连接行 "inst_2 I_1"，与Net::addConnection一致
+static bool parseConnection(const char* lineBegin, const char* lineEnd, Net* net, ParsedNet& result) {
+  const char* tokens[3][2];
+  int numTokens = 0;
+  const char* p = lineBegin;
+  while (numTokens < 3 && nextToken(p, lineEnd, tokens[numTokens][0], tokens[numTokens][1])) {
+    numTokens++;
+  }
+  if (numTokens != 2) {
+    result.messages += "Error: Invalid connection format " + std::string(lineBegin, lineEnd) + "\n";
     return false;
   }
 
-  int numErr = 0;
-  std::string line;
-  std::vector<std::string> netLines;
-  bool isInsideNet = false;
-  std::string netInfoStr;
+  Instance* instPtr = nullptr;
+  int instID;
+  if (parseIDAfterUnderscore(tokens[0][0], tokens[0][1], instID)) {
+    auto it = glbInstMap.find(instID);
+    if (it != glbInstMap.end()) {
+      instPtr = it->second;
+    }
+  }
+  if (instPtr == nullptr) {
+    result.messages += "Invalid instance name format: " + std::string(tokens[0][0], tokens[0][1]) + "\n";
+    return false;
+  }
 
-  while (std::getline(inputFile, line)) {
-    if (line.empty() || line[0] == '#') {
+  const char* underscore = static_cast<const char*>(memchr(tokens[1][0], '_', tokens[1][1] - tokens[1][0]));
+  if (underscore == nullptr) {
+    return true;
+  }
+  std::string dirStr(tokens[1][0], underscore);
+  int pinID = -1;
+  parseInt(underscore + 1, tokens[1][1], pinID);
+  Pin* pinPtr = nullptr;
+  if (dirStr == "I" && pinID >= 0 && pinID < instPtr->getNumInpins()) {
+    pinPtr = instPtr->getInpin(pinID);
+    net->addOutputPin(pinPtr);
+  } else if (dirStr == "O" && pinID >= 0 && pinID < instPtr->getNumOutpins()) {
+    pinPtr = instPtr->getOutpin(pinID);
+    if (net->getInpin() != nullptr) {
+      result.messages += "Error: Multiple drivers for net ID = " + std::to_string(net->getId()) + "\n";
+      result.numErr++;
+    }
+    net->setInpin(pinPtr);
+  } else {
+    result.messages += "Invalid pin name format: " + std::string(tokens[1][0], tokens[1][1]) + "\n";
+    return false;
+  }
+  result.pins.push_back(pinPtr);
+  return true;
+}
+
+// 解析从header开始的一个net块，[headerBegin, headerEnd)为"net ..."行，pinLines为之后到endnet之前的行
+static void parseNetBlock(const char* headerBegin, const char* headerEnd,
+                          const std::vector<std::pair<const char*, const char*>>& pinLines,
+                          std::vector<ParsedNet>& results) {
+  const char* tokens[3][2];
+  int numTokens = 0;
+  const char* p = headerBegin + std::min<long>(4, headerEnd - headerBegin);
+  while (numTokens < 3 && nextToken(p, headerEnd, tokens[numTokens][0], tokens[numTokens][1])) {
+    numTokens++;
+  }
+  ParsedNet result;
+  if (numTokens < 2) {
+    result.messages += "Invalid net header " + std::string(headerBegin, headerEnd) + "\n";
+    results.push_back(std::move(result));
+    return;
+  }
+  std::string netNameStr(tokens[0][0], tokens[0][1]);
+  int netID = -1;
+  if (!parseIDAfterUnderscore(tokens[0][0], tokens[0][1], netID)) {
+    netID = -1;
+    result.messages += "Invalid name format: " + netNameStr + "\n";
+  }
+
+  int numPins = -1;
+  parseInt(tokens[1][0], tokens[1][1], numPins);
+  if ((int)pinLines.size() != numPins) {
+    // The first line is the net name, the last line is the ending maker
+    result.messages += "Wrong number of connections of net " + netNameStr + "\n";
+    results.push_back(std::move(result));
+    return;
+  }
+
+  // Create a new Net object
+  Net* newNet = new Net(netID);
+  for (auto& line : pinLines) {
+    if (parseConnection(line.first, line.second, newNet, result) == false) {
+      result.numErr++;
+    }
+  }
+  if (numTokens == 3 && std::string(tokens[2][0], tokens[2][1]) == "clock") {
+    newNet->setClock(true);
+  }
+  result.net = newNet;
+  results.push_back(std::move(result));
+}
+
+// 解析header起始位置在[chunkBegin, chunkEnd)内的net块，最后一个块可以越过chunkEnd
+static void parseNetChunk(const char* fileEnd, const char* chunkBegin, const char* chunkEnd, std::vector<ParsedNet>& results) {
+  const char* cur = chunkBegin;
+  const char* lineBegin;
+  const char* lineEnd;
+  bool isInsideNet = false;
+  const char* headerBegin = nullptr;
+  const char* headerEnd = nullptr;
+  std::vector<std::pair<const char*, const char*>> pinLines;
+  while (nextLine(cur, fileEnd, lineBegin, lineEnd)) {
+    if (lineBegin == lineEnd || lineBegin[0] == '#') {
       continue;
     }
-    if (line.substr(0, 3) == "net") {
+    if (startsWith(lineBegin, lineEnd, "net")) {
+      if (lineBegin >= chunkEnd) {
+        break; // 之后的块属于下一段
+      }
       isInsideNet = true;
-      netInfoStr = line.substr(4);
-      netLines.clear();
+      headerBegin = lineBegin;
+      headerEnd = lineEnd;
+      pinLines.clear();
+      continue;
+    }
+    if (startsWith(lineBegin, lineEnd, "endnet")) {
+      if (isInsideNet) {
+        parseNetBlock(headerBegin, headerEnd, pinLines, results);
+      }
+      isInsideNet = false;
+      if (lineBegin >= chunkEnd) {
+        break;
+      }
+      continue;
     }
     if (isInsideNet) {
-      netLines.push_back(line);
+      pinLines.emplace_back(lineBegin, lineEnd);
+    } else if (lineBegin >= chunkEnd) {
+      break;
     }
-    if (line.substr(0, 6) == "endnet") {
-      isInsideNet = false;
+  }
+}
 
-      std::istringstream iss(netInfoStr);
-      std::vector<std::string> tokens;
-      std::string token;
-      while (iss >> token) {
-        tokens.push_back(token);
-      }
+bool readInputNets(const std::string& fileName) {
+  MappedFile inputFile(fileName);
+  if (!inputFile.isOpen()) {
+    std::cout << "Failed to open file: " << fileName << std::endl;
+    return false;
+  }
 
-      std::string netNameStr = tokens[0];
-      int netID = -1;
-      size_t underscorePos = netNameStr.find('_');
-      if (underscorePos != std::string::npos) {
-        std::string subStr = netNameStr.substr(underscorePos + 1);
-        // Convert the second substring to an integer
-        netID = std::stoi(subStr);
-      } else {
-        std::cout << "Invalid name format: " << netNameStr << std::endl;
-      }
+  // 按字节均分，每段从其后第一个完整的行开始，至少1MB一段
+  const size_t minChunkSize = 1 << 20;
+  int numThreads = std::thread::hardware_concurrency();
+  if (numThreads <= 0) {
+    numThreads = 4;
+  }
+  numThreads = std::max<int>(1, std::min<size_t>(numThreads, inputFile.size() / minChunkSize));
+  std::vector<const char*> bounds(numThreads + 1);
+  bounds[0] = inputFile.begin();
+  bounds[numThreads] = inputFile.end();
+  for (int t = 1; t < numThreads; t++) {
+    const char* p = inputFile.begin() + inputFile.size() * t / numThreads;
+    if (p[-1] != '\n') {
+      const char* nl = static_cast<const char*>(memchr(p, '\n', inputFile.end() - p));
+      p = nl == nullptr ? inputFile.end() : nl + 1;
+    }
+    bounds[t] = std::max(p, bounds[t - 1]);
+  }
 
-      unsigned int numPins = std::stoi(tokens[1]);
-      if (netLines.size() != (numPins + 2)) {
-        // The first line is the net name, the last line is the ending maker
-        std::cout << "Wrong number of connections of net " << netNameStr << std::endl;
+  std::vector<std::vector<ParsedNet>> chunkResults(numThreads);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < numThreads; t++) {
+    threads.emplace_back(parseNetChunk, inputFile.end(), bounds[t], bounds[t + 1], std::ref(chunkResults[t]));
+  }
+  parseNetChunk(inputFile.end(), bounds[0], bounds[1], chunkResults[0]);
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  // 按文件顺序合并，结果与单线程读入一致
+  int numErr = 0;
+  for (auto& results : chunkResults) {
+    for (auto& result : results) {
+      std::cout << result.messages;
+      numErr += result.numErr;
+      if (result.net == nullptr) {
         continue;
       }
-
-      // Create a new Net object
-      Net* newNet = new Net(netID);
-      unsigned int idx = 0;
-      for (auto conn : netLines) {
-        if (idx == 0 || idx == netLines.size() - 1) {
-          // skip starting and ending lines 
-          idx++;
-          continue;
-        }
-        if (newNet->addConnection(conn) == false) {
-          numErr++;
-        }
-        idx++;
+      for (Pin* pin : result.pins) {
+        pin->setNetID(result.net->getId());
       }
-      if (tokens.size() == 3) {
-        std::string clockStr = tokens[2];
-        if (clockStr == "clock") {
-          newNet->setClock(true);
-        }
-      } 
-     
       // Add the new Net object to the netMap
-      glbNetMap[netID] = newNet;
+      glbNetMap[result.net->getId()] = result.net;
     }
   }
-  inputFile.close();
 
   if (numErr > 0 ) {
     return false;
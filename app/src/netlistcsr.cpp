@@ -0,0 +1,247 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include "global.h"
+#include "netlistcsr.h"
+#include "rsmt.h"
+#include "steinercache.h"
+
+FlatNetlist glbFlatNetlist;
+FlatNetlist glbFlatPackNetlist;
+
+const FlatNetlist *getFlatNetlist(const std::map<int, Net *> &netMap)
+{
+    if (glbFlatNetlist.isBuilt(netMap))
+        return &glbFlatNetlist;
+    if (glbFlatPackNetlist.isBuilt(netMap))
+        return &glbFlatPackNetlist;
+    return nullptr;
+}
+
+void FlatNetlist::clear()
+{
+    built = false;
+    source = nullptr;
+    netIds.clear();
+    netPtrs.clear();
+    netIndex.clear();
+    netClock.clear();
+    netDriver.clear();
+    netPinStart.clear();
+    pinInst.clear();
+    pinInstId.clear();
+    pinCrit.clear();
+    pinProp.clear();
+    insts.clear();
+    instIndex.clear();
+    instNetStart.clear();
+    instNets.clear();
+    netInstStart.clear();
+    netInstIds.clear();
+}
+
+void FlatNetlist::build(std::map<int, Net *> &netMap)
+{
+    clear();
+    int maxNetId = netMap.empty() ? -1 : netMap.rbegin()->first;
+    netIndex.assign(maxNetId + 1, -1);
+    netIds.reserve(netMap.size());
+    netPinStart.reserve(netMap.size() + 1);
+    netPinStart.push_back(0);
+
+    bool valid = true;
+    auto addPin = [this, &valid](Pin *pin) {
+        Instance *inst = pin->getInstanceOwner();
+        int id = inst->getInstID();
+        if (id < 0)
+        {
+            valid = false;
+            return;
+        }
+        if (id >= (int)instIndex.size())
+        {
+            instIndex.resize(id + 1, -1);
+        }
+        int &idx = instIndex[id];
+        if (idx == -1)
+        {
+            idx = insts.size();
+            insts.push_back(inst);
+        }
+        pinInst.push_back(idx);
+        pinInstId.push_back(id);
+        pinCrit.push_back(pin->getTimingCritical());
+        pinProp.push_back(pin->getProp());
+    };
+
+    for (auto &iter : netMap)
+    {
+        Net *net = iter.second;
+        if (iter.first < 0)
+        {
+            std::cout << "Error: invalid net ID " << iter.first << std::endl;
+            continue;
+        }
+        netIndex[iter.first] = netIds.size();
+        netIds.push_back(iter.first);
+        netPtrs.push_back(net);
+        netClock.push_back(net->isClock());
+        netDriver.push_back(net->getInpin() != nullptr);
+        if (net->getInpin() != nullptr)
+        {
+            addPin(net->getInpin());
+        }
+        for (Pin *pin : net->getOutputPins())
+        {
+            addPin(pin);
+        }
+        netPinStart.push_back(pinInst.size());
+    }
+
+    if (!valid)
+    {
+        // 坐标按instID读取，存在没有instID的inst时不能使用
+        std::cout << "Error: instance without ID found when building flat netlist" << std::endl;
+        clear();
+        return;
+    }
+
+    // inst -> net，先计数再填充
+    std::vector<int> lastNet(insts.size(), -1);
+    instNetStart.assign(insts.size() + 1, 0);
+    for (int n = 0; n < (int)netIds.size(); n++)
+    {
+        for (int p = netPinStart[n]; p < netPinStart[n + 1]; p++)
+        {
+            int inst = pinInst[p];
+            if (lastNet[inst] != n)
+            {
+                lastNet[inst] = n;
+                instNetStart[inst + 1]++;
+            }
+        }
+    }
+    for (int i = 0; i < (int)insts.size(); i++)
+    {
+        instNetStart[i + 1] += instNetStart[i];
+    }
+    instNets.resize(instNetStart.back());
+    std::vector<int> fill(instNetStart.begin(), instNetStart.end() - 1);
+    std::fill(lastNet.begin(), lastNet.end(), -1);
+    netInstStart.reserve(netIds.size() + 1);
+    netInstStart.push_back(0);
+    for (int n = 0; n < (int)netIds.size(); n++)
+    {
+        for (int p = netPinStart[n]; p < netPinStart[n + 1]; p++)
+        {
+            int inst = pinInst[p];
+            if (lastNet[inst] != n)
+            {
+                lastNet[inst] = n;
+                instNets[fill[inst]++] = n;
+                netInstIds.push_back(pinInstId[p]);
+            }
+        }
+        netInstStart.push_back(netInstIds.size());
+    }
+
+    source = &netMap;
+    built = true;
+}
+
+int FlatNetlist::findNet(Net *net) const
+{
+    int idx = getNetIndex(net->getId());
+    return idx != -1 && netPtrs[idx] == net ? idx : -1;
+}
+
+int FlatNetlist::getNetWireLength(int idx, const PlacementState &state) const
+{
+    if (!netDriver[idx])
+    {
+        return 0;
+    }
+    int begin = netPinStart[idx], end = netPinStart[idx + 1];
+    const int *xs = state.x.data();
+    const int *ys = state.y.data();
+    int driverX = xs[pinInstId[begin]];
+    int driverY = ys[pinInstId[begin]];
+
+    // 关键sink与非关键sink分别去重，坐标打包成整数后排序，顺序与std::set<std::pair<int,int>>一致
+    // 每个线程复用自己的缓冲区，SA中逐net调用时不再分配内存
+    static thread_local std::vector<unsigned long long> critKeys, nonCritKeys;
+    static thread_local std::vector<int> xCoords, yCoords;
+    critKeys.clear();
+    nonCritKeys.clear();
+    nonCritKeys.push_back(packXY(driverX, driverY));
+    for (int p = begin + 1; p < end; p++)
+    {
+        int id = pinInstId[p];
+        unsigned long long key = packXY(xs[id], ys[id]);
+        if (pinCrit[p])
+            critKeys.push_back(key);
+        else
+            nonCritKeys.push_back(key);
+    }
+    std::sort(critKeys.begin(), critKeys.end());
+    critKeys.erase(std::unique(critKeys.begin(), critKeys.end()), critKeys.end());
+    std::sort(nonCritKeys.begin(), nonCritKeys.end());
+    nonCritKeys.erase(std::unique(nonCritKeys.begin(), nonCritKeys.end()), nonCritKeys.end());
+
+    int wirelength = 0;
+    for (unsigned long long key : critKeys)
+    {
+        wirelength += std::abs(unpackX(key) - driverX) + std::abs(unpackY(key) - driverY);
+    }
+    if (nonCritKeys.size() > 1)
+    {
+        xCoords.resize(nonCritKeys.size());
+        yCoords.resize(nonCritKeys.size());
+        for (int i = 0; i < (int)nonCritKeys.size(); i++)
+        {
+            xCoords[i] = unpackX(nonCritKeys[i]);
+            yCoords[i] = unpackY(nonCritKeys[i]);
+        }
+        wirelength += glbSteinerCache.getWireLength(xCoords.data(), yCoords.data(), xCoords.size());
+    }
+    return wirelength;
+}
+
+int FlatNetlist::getNetHPWL(int idx, const PlacementState &state) const
+{
+    int begin = netPinStart[idx], end = netPinStart[idx + 1];
+    if (begin == end)
+    {
+        return 0;
+    }
+    const int *xs = state.x.data();
+    const int *ys = state.y.data();
+    int xMin = xs[pinInstId[begin]], xMax = xMin;
+    int yMin = ys[pinInstId[begin]], yMax = yMin;
+    for (int p = begin + 1; p < end; p++)
+    {
+        int id = pinInstId[p];
+        xMin = std::min(xMin, xs[id]);
+        xMax = std::max(xMax, xs[id]);
+        yMin = std::min(yMin, ys[id]);
+        yMax = std::max(yMax, ys[id]);
+    }
+    return xMax - xMin + yMax - yMin;
+}
+
+std::pair<int, int> FlatNetlist::getNetCenter(int idx, const PlacementState &state) const
+{
+    // 一个inst有多个引脚在同一net时只计算一次
+    int begin = netInstStart[idx], end = netInstStart[idx + 1];
+    if (begin == end)
+    {
+        return std::make_pair(0, 0);
+    }
+    int x = 0, y = 0;
+    for (int i = begin; i < end; i++)
+    {
+        x += state.x[netInstIds[i]];
+        y += state.y[netInstIds[i]];
+    }
+    return std::make_pair(x / (end - begin), y / (end - begin));
+}
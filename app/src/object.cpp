@@ -1,10 +1,12 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include <set>
 #include "global.h"
 #include "object.h"
 #include "rsmt.h"
+#include "steinercache.h"
 #include "util.h"
 
 Tile::~Tile()
@@ -40,6 +42,200 @@ bool Tile::matchType(const std::string &modelType)
   return tileTypes.find(matchType) != tileTypes.end();
 }
 
+void occupancyClear(TileOccupancy &occ)
+{
+  occ.lutUsed = 0;
+  occ.lutPacked = 0;
+  occ.dramUsed = 0;
+  occ.carryUsed = 0;
+  occ.seqUsed = 0;
+  std::fill(occ.lutCount, occ.lutCount + MAX_LUT_CAPACITY, 0);
+  std::fill(occ.seqCount, occ.seqCount + MAX_DFF_CAPACITY, 0);
+  std::fill(occ.dramCount, occ.dramCount + MAX_DRAM_CAPACITY, 0);
+  std::fill(occ.carryCount, occ.carryCount + MAX_CARRY4_CAPACITY, 0);
+  for (int i = 0; i < MAX_LUT_CAPACITY; i++)
+  {
+    occ.lutInputNets[i].clear();
+  }
+  for (int bank = 0; bank < 2; bank++)
+  {
+    occ.clkNets[bank].clear();
+    occ.ceNets[bank].clear();
+    occ.srNets[bank].clear();
+  }
+}
+
+// delta 为 1 表示加入，-1 表示移除
+static void occupancyUpdate(TileOccupancy &occ, const std::string &slotType, int offset, Instance *inst, int delta)
+{
+  if (slotType == "LUT" && offset < MAX_LUT_CAPACITY)
+  {
+    occ.lutCount[offset] += delta;
+    if (occ.lutCount[offset] > 0)
+      occ.lutUsed |= (1 << offset);
+    else
+      occ.lutUsed &= ~(1 << offset);
+    if (inst == nullptr)
+      return;
+    if (inst->getNumMapInstID() == 2)
+    {
+      if (delta > 0)
+        occ.lutPacked |= (1 << offset);
+      else
+        occ.lutPacked &= ~(1 << offset);
+    }
+    for (int i = 0; i < inst->getNumInpins(); i++)
+    {
+      int netID = inst->getInpin(i)->getNetID();
+      if (netID == -1)
+        continue;
+      if (delta > 0)
+        occ.lutInputNets[offset].add(netID);
+      else
+        occ.lutInputNets[offset].remove(netID);
+    }
+  }
+  else if (slotType == "SEQ" && offset < MAX_DFF_CAPACITY)
+  {
+    occ.seqCount[offset] += delta;
+    if (occ.seqCount[offset] > 0)
+      occ.seqUsed |= (1 << offset);
+    else
+      occ.seqUsed &= ~(1 << offset);
+    if (inst == nullptr)
+      return;
+    int bank = offset / 8;
+    for (int i = 0; i < inst->getNumInpins(); i++)
+    {
+      Pin *pin = inst->getInpin(i);
+      int netID = pin->getNetID();
+      if (netID < 0)
+        continue;
+      NetRefTable<MAX_OCC_CTRL_NETS> *table = nullptr;
+      PinProp prop = pin->getProp();
+      if (prop == PIN_PROP_CE)
+        table = &occ.ceNets[bank];
+      else if (prop == PIN_PROP_CLOCK)
+        table = &occ.clkNets[bank];
+      else if (prop == PIN_PROP_RESET)
+        table = &occ.srNets[bank];
+      if (table == nullptr)
+        continue;
+      if (delta > 0)
+        table->add(netID);
+      else
+        table->remove(netID);
+    }
+  }
+  else if (slotType == "DRAM" && offset < MAX_DRAM_CAPACITY)
+  {
+    occ.dramCount[offset] += delta;
+    if (occ.dramCount[offset] > 0)
+      occ.dramUsed |= (1 << offset);
+    else
+      occ.dramUsed &= ~(1 << offset);
+  }
+  else if (slotType == "CARRY4" && offset < MAX_CARRY4_CAPACITY)
+  {
+    occ.carryCount[offset] += delta;
+    if (occ.carryCount[offset] > 0)
+      occ.carryUsed |= (1 << offset);
+    else
+      occ.carryUsed &= ~(1 << offset);
+  }
+}
+
+void occupancyAdd(TileOccupancy &occ, const std::string &slotType, int offset, Instance *inst)
+{
+  occupancyUpdate(occ, slotType, offset, inst, 1);
+}
+
+void occupancyRemove(TileOccupancy &occ, const std::string &slotType, int offset, Instance *inst)
+{
+  occupancyUpdate(occ, slotType, offset, inst, -1);
+}
+
+static Instance *findInstance(int instID)
+{
+  auto it = glbInstMap.find(instID);
+  return it == glbInstMap.end() ? nullptr : it->second;
+}
+
+void Tile::rebuildOccupancy()
+{
+  for (int view = 0; view < 2; view++)
+  {
+    occupancyClear(occupancy[view]);
+    for (auto &pair : instanceMap)
+    {
+      for (int offset = 0; offset < (int)pair.second.size(); offset++)
+      {
+        Slot *slot = pair.second[offset];
+        const SlotInstances &instances = slot->getInstances(view);
+        for (int instID : instances)
+        {
+          occupancyAdd(occupancy[view], pair.first, offset, findInstance(instID));
+        }
+      }
+    }
+  }
+}
+
+bool Tile::removeInstanceAt(int instID, int offset, std::string modelType, const bool isBaseline)
+{
+  std::string mtp = unifyModelType(modelType);
+  auto mapIter = instanceMap.find(mtp);
+  if (mapIter == instanceMap.end() || offset >= (int)mapIter->second.size())
+  {
+    return false;
+  }
+  Slot *slot = mapIter->second[offset];
+  SlotInstances &instances = slot->getInstancesRef(isBaseline);
+  auto it = std::find(instances.begin(), instances.end(), instID);
+  if (it == instances.end())
+  {
+    return false;
+  }
+  instances.erase(it);
+  occupancyRemove(occupancy[isBaseline], mtp, offset, findInstance(instID));
+  return true;
+}
+
+bool Tile::insertInstanceAt(int instID, int offset, int pos, std::string modelType, const bool isBaseline)
+{
+  std::string mtp = unifyModelType(modelType);
+  auto mapIter = instanceMap.find(mtp);
+  if (mapIter == instanceMap.end() || offset >= (int)mapIter->second.size())
+  {
+    return false;
+  }
+  SlotInstances &instances = mapIter->second[offset]->getInstancesRef(isBaseline);
+  if (pos < 0 || pos > (int)instances.size())
+  {
+    return false;
+  }
+  instances.insert(pos, instID);
+  occupancyAdd(occupancy[isBaseline], mtp, offset, findInstance(instID));
+  return true;
+}
+
+void Tile::clearSlot(int offset, std::string modelType, const bool isBaseline)
+{
+  std::string mtp = unifyModelType(modelType);
+  auto mapIter = instanceMap.find(mtp);
+  if (mapIter == instanceMap.end() || offset >= (int)mapIter->second.size())
+  {
+    return;
+  }
+  Slot *slot = mapIter->second[offset];
+  SlotInstances &instances = slot->getInstancesRef(isBaseline);
+  for (int instID : instances)
+  {
+    occupancyRemove(occupancy[isBaseline], mtp, offset, findInstance(instID));
+  }
+  instances.clear();
+}
+
 bool Tile::addInstance(int instID, int offset, std::string modelType, const bool isBaseline)
 {
   if (matchType(modelType) == false)
@@ -71,6 +267,7 @@ bool Tile::addInstance(int instID, int offset, std::string modelType, const bool
   {
     mapIter->second[offset]->addOptimizedInstance(instID);
   }
+  occupancyAdd(occupancy[isBaseline], mtp, offset, findInstance(instID));
   return true;
 }
 
@@ -284,6 +481,8 @@ void Tile::clearInstances()
       slot->clearInstances();
     }
   }
+  occupancyClear(occupancy[0]);
+  occupancyClear(occupancy[1]);
 }
 
 void Tile::clearBaselineInstances()
@@ -295,6 +494,7 @@ void Tile::clearBaselineInstances()
       slot->clearBaselineInstances();
     }
   }
+  occupancyClear(occupancy[1]);
 }
 
 void Tile::clearOptimizedInstances()
@@ -306,6 +506,7 @@ void Tile::clearOptimizedInstances()
       slot->clearOptimizedInstances();
     }
   }
+  occupancyClear(occupancy[0]);
 }
 
 // 只清理LUT
@@ -321,6 +522,7 @@ void Tile::clearLUTOptimizedInstances()
       }
     }
   }
+  rebuildOccupancy();
 }
 
 // 只清理SEQ
@@ -336,6 +538,7 @@ void Tile::clearSEQOptimizedInstances()
       }
     }
   }
+  rebuildOccupancy();
 }
 
 slotArr *Tile::getInstanceByType(std::string type)
@@ -399,8 +602,8 @@ void Tile::reportTile()
       }
       std::cout << "  " << pair.first << " #" << i << " (baseline, optimized)" << std::endl;
 
-      std::list<int> baselineInstArr = pair.second[i]->getBaselineInstances();
-      std::list<int> optimizedInstArr = pair.second[i]->getOptimizedInstances();
+      const SlotInstances &baselineInstArr = pair.second[i]->getBaselineInstances();
+      const SlotInstances &optimizedInstArr = pair.second[i]->getOptimizedInstances();
 
       // print two columns
       // left one is baseline instances
@@ -696,14 +899,16 @@ bool Tile::removeInstance(Instance *inst)
   }
 
   // 遍历Slot，查找并移除该实例
-  for (Slot *slot : mapIter->second)
+  for (int offset = 0; offset < (int)mapIter->second.size(); offset++)
   {
-    std::list<int> &instances = slot->getBaselineInstances(); // 获取优化后的实例列表引用
+    Slot *slot = mapIter->second[offset];
+    SlotInstances &instances = slot->getBaselineInstancesRef(); // 获取实例列表引用
     for (auto it = instances.begin(); it != instances.end(); ++it)
     {
-      if (*it == std::stoi(inst->getInstanceName().substr(5)))
+      if (*it == inst->getInstID())
       {                      // 移除以inst_xxx的形式表示的实例
         instances.erase(it); // 找到实例并移除
+        occupancyRemove(occupancy[1], unifiedModelType, offset, inst);
         return true;         // 成功移除，返回true
       }
     }
@@ -895,9 +1100,9 @@ std::set<int> Tile::getConnectedLutSeqInput(bool isBaseline)
     return netSet;
   }
 
-  for (auto mapIter : instanceMap)
+  for (auto &mapIter : instanceMap)
   {
-    std::string slotType = mapIter.first;
+    const std::string &slotType = mapIter.first;
 
     if (slotType != "LUT" && slotType != "SEQ")
     {
@@ -906,15 +1111,7 @@ std::set<int> Tile::getConnectedLutSeqInput(bool isBaseline)
 
     for (auto slot : mapIter.second)
     {
-      std::list<int> instArr;
-      if (isBaseline)
-      {
-        instArr = slot->getBaselineInstances();
-      }
-      else
-      {
-        instArr = slot->getOptimizedInstances();
-      }
+      const SlotInstances &instArr = slot->getInstances(isBaseline);
       for (auto instID : instArr)
       {
         if (glbInstMap.find(instID) == glbInstMap.end())
@@ -981,9 +1178,9 @@ std::set<int> Tile::getConnectedLutSeqOutput(bool isBaseline)
     return netSet;
   }
 
-  for (auto mapIter : instanceMap)
+  for (auto &mapIter : instanceMap)
   {
-    std::string slotType = mapIter.first;
+    const std::string &slotType = mapIter.first;
     if (slotType != "LUT" && slotType != "SEQ")
     {
       continue;
@@ -991,15 +1188,7 @@ std::set<int> Tile::getConnectedLutSeqOutput(bool isBaseline)
 
     for (auto slot : mapIter.second)
     {
-      std::list<int> instArr;
-      if (isBaseline)
-      {
-        instArr = slot->getBaselineInstances();
-      }
-      else
-      {
-        instArr = slot->getOptimizedInstances();
-      }
+      const SlotInstances &instArr = slot->getInstances(isBaseline);
       for (auto instID : instArr)
       {
         if (glbInstMap.find(instID) == glbInstMap.end())
@@ -1046,9 +1235,9 @@ bool Tile::getControlSet(
     std::set<int> &srNets)
 {
 
-  for (auto mapIter : instanceMap)
+  for (auto &mapIter : instanceMap)
   {
-    std::string slotType = mapIter.first;
+    const std::string &slotType = mapIter.first;
     // in PLB, only SEQ has control pins
     if (slotType != "SEQ")
     {
@@ -1077,15 +1266,7 @@ bool Tile::getControlSet(
     for (int slotIdx = startIdx; slotIdx <= endIdx; slotIdx++)
     {
       Slot *slotPtr = mapIter.second[slotIdx];
-      std::list<int> instArr;
-      if (isBaseline)
-      {
-        instArr = slotPtr->getBaselineInstances();
-      }
-      else
-      {
-        instArr = slotPtr->getOptimizedInstances();
-      }
+      const SlotInstances &instArr = slotPtr->getInstances(isBaseline);
       for (auto instID : instArr)
       {
         if (glbInstMap.find(instID) == glbInstMap.end())
@@ -1170,15 +1351,7 @@ void Tile::getRemainingPLBResources(bool isBaseline)
       if (!slot)
         continue;
 
-      std::list<int> instances;
-      if (isBaseline)
-      {
-        instances = slot->getBaselineInstances();
-      }
-      else
-      {
-        instances = slot->getOptimizedInstances();
-      }
+      const SlotInstances &instances = slot->getInstances(isBaseline);
 
       // 统计LUT的使用情况和实际引脚数
       if (modelType == "LUT")
@@ -1236,15 +1409,11 @@ int Tile::findOffset(std::string instTypes, Instance *inst, bool isBaseline)
       netIdSet.insert(net->getId());
     }
 
-    slotArr slotArrTmp = instanceMap[instTypes];
+    slotArr &slotArrTmp = instanceMap[instTypes];
     for (int i = 0; i < slotArrTmp.size(); i++)
     {
       Slot *slot = slotArrTmp[i];
-      std::list<int> listTmp;
-      if (isBaseline)
-        listTmp = slot->getBaselineInstances();
-      else
-        listTmp = slot->getOptimizedInstances();
+      const SlotInstances &listTmp = slot->getInstances(isBaseline);
       // 当已经插入的inst大于等于2则不考虑了
       if (listTmp.size() >= 2)
       {
@@ -1284,7 +1453,7 @@ int Tile::findOffset(std::string instTypes, Instance *inst, bool isBaseline)
   else if (instTypes == "SEQ")
   {
     int instID = std::stoi(inst->getInstanceName().substr(5)); // 从第5个字符开始截取，转换为整数
-    slotArr slotArrTmp = instanceMap[instTypes];
+    slotArr &slotArrTmp = instanceMap[instTypes];
     for (int j = 0; j < 2; j++)
     {
       // bank0-1
@@ -1293,11 +1462,7 @@ int Tile::findOffset(std::string instTypes, Instance *inst, bool isBaseline)
       for (int i = j * 8; i < (j + 1) * 8; i++)
       {
         Slot *slotTmp = slotArrTmp[i];
-        std::list<int> instListTmp;
-        if (isBaseline)
-          instListTmp = slotTmp->getBaselineInstances();
-        else
-          instListTmp = slotTmp->getOptimizedInstances();
+        const SlotInstances &instListTmp = slotTmp->getInstances(isBaseline);
         for (int id : instListTmp)
         {
           bankId.insert(id);
@@ -1346,15 +1511,11 @@ int Tile::findOffset(std::string instTypes, Instance *inst, bool isBaseline)
       else
       {
         // SEQ只要返回一个空位子即可
-        slotArr slotArrTmp = instanceMap[instTypes];
+        slotArr &slotArrTmp = instanceMap[instTypes];
         for (int i = j * 8; i < (j + 1) * 8; i++)
         {
           Slot *slot = slotArrTmp[i];
-          std::list<int> listTmp;
-          if (isBaseline)
-            listTmp = slot->getBaselineInstances();
-          else
-            listTmp = slot->getOptimizedInstances();
+          const SlotInstances &listTmp = slot->getInstances(isBaseline);
           if (listTmp.size() == 0)
           {
             offset = i;
@@ -1456,6 +1617,7 @@ Instance::~Instance()
 
 Instance::Instance()
 {
+  instID = -1;
   cellLib = nullptr;
   fixed = false;
   setLocation(std::make_tuple(-1, -1, -1));
@@ -1467,7 +1629,6 @@ Instance::Instance()
   lutInitialed = false;
   lutSetID = -1;
   seqGroupID = -1;
-  instID = -1;
 }
 
 bool Instance::isPlaced()
@@ -1837,6 +1998,20 @@ bool Net::addConnection(std::string conn)
   }
 }
 
+// 按instID从PlacementState读取坐标，没有instID的inst读取Instance中的坐标
+static inline void getInstXY(const PlacementState &state, bool isBaseline, const Instance *inst, int &x, int &y)
+{
+  int id = inst->getInstID();
+  if (id >= 0 && id < state.size())
+  {
+    x = state.x[id];
+    y = state.y[id];
+    return;
+  }
+  int z;
+  std::tie(x, y, z) = isBaseline ? inst->getBaseLocation() : inst->getLocation();
+}
+
 int Net::getCritWireLength(bool isBaseline)
 {
   int wirelength = 0;
@@ -1846,39 +2021,28 @@ int Net::getCritWireLength(bool isBaseline)
     return 0; // Return 0 if there's no driver pin
   }
 
-  std::tuple<int, int, int> driverLoc;
-  if (isBaseline)
-  {
-    driverLoc = driverPin->getInstanceOwner()->getBaseLocation();
-  }
-  else
-  {
-    driverLoc = driverPin->getInstanceOwner()->getLocation();
-  }
+  // 视图每个net只选择一次
+  const PlacementState &state = glbPlacementState[isBaseline];
+  int driverX, driverY;
+  getInstXY(state, isBaseline, driverPin->getInstanceOwner(), driverX, driverY);
 
-  std::set<std::pair<int, int>> mergedPinLocs; // merge identical pin locations  //保存x与y的坐标
+  std::vector<unsigned long long> mergedPinLocs; // merge identical pin locations  //(x,y)打包后排序去重
   for (const auto *outpin : getOutputPins())
   {
     if (!outpin->getTimingCritical())
     {
       continue;
     }
-    std::tuple<int, int, int> sinkLoc;
-    if (isBaseline)
-    {
-      sinkLoc = outpin->getInstanceOwner()->getBaseLocation();
-    }
-    else
-    {
-      sinkLoc = outpin->getInstanceOwner()->getLocation();
-    }
-    mergedPinLocs.insert(std::make_pair(std::get<0>(sinkLoc), std::get<1>(sinkLoc)));
+    int x, y;
+    getInstXY(state, isBaseline, outpin->getInstanceOwner(), x, y);
+    mergedPinLocs.push_back(packXY(x, y));
   }
+  std::sort(mergedPinLocs.begin(), mergedPinLocs.end());
+  mergedPinLocs.erase(std::unique(mergedPinLocs.begin(), mergedPinLocs.end()), mergedPinLocs.end());
 
-  for (auto loc : mergedPinLocs)
+  for (unsigned long long loc : mergedPinLocs)
   {
-    wirelength += std::abs(std::get<0>(loc) - std::get<0>(driverLoc)) +
-                  std::abs(std::get<1>(loc) - std::get<1>(driverLoc));
+    wirelength += std::abs(unpackX(loc) - driverX) + std::abs(unpackY(loc) - driverY);
   }
 
   return wirelength;
@@ -2045,18 +2209,12 @@ void Net::getMergedNonCritPinLocs(bool isBaseline, std::vector<int> &xCoords, st
   {
     return;
   }
-  std::set<std::pair<int, int>> rsmtPinLocs;
-
-  std::tuple<int, int, int> driverLoc;
-  if (isBaseline)
-  {
-    driverLoc = driverPin->getInstanceOwner()->getBaseLocation();
-  }
-  else
-  {
-    driverLoc = driverPin->getInstanceOwner()->getLocation();
-  }
-  rsmtPinLocs.insert(std::make_pair(std::get<0>(driverLoc), std::get<1>(driverLoc)));
+  // (x,y)打包后排序去重，顺序与std::set<std::pair<int,int>>一致
+  const PlacementState &state = glbPlacementState[isBaseline];
+  std::vector<unsigned long long> rsmtPinLocs;
+  int x, y;
+  getInstXY(state, isBaseline, driverPin->getInstanceOwner(), x, y);
+  rsmtPinLocs.push_back(packXY(x, y));
 
   for (const auto *outpin : getOutputPins())
   {
@@ -2064,21 +2222,15 @@ void Net::getMergedNonCritPinLocs(bool isBaseline, std::vector<int> &xCoords, st
     {
       continue;
     }
-    std::tuple<int, int, int> sinkLoc;
-    if (isBaseline)
-    {
-      sinkLoc = outpin->getInstanceOwner()->getBaseLocation();
-    }
-    else
-    {
-      sinkLoc = outpin->getInstanceOwner()->getLocation();
-    }
-    rsmtPinLocs.insert(std::make_pair(std::get<0>(sinkLoc), std::get<1>(sinkLoc)));
+    getInstXY(state, isBaseline, outpin->getInstanceOwner(), x, y);
+    rsmtPinLocs.push_back(packXY(x, y));
   }
-  for (auto loc : rsmtPinLocs)
+  std::sort(rsmtPinLocs.begin(), rsmtPinLocs.end());
+  rsmtPinLocs.erase(std::unique(rsmtPinLocs.begin(), rsmtPinLocs.end()), rsmtPinLocs.end());
+  for (unsigned long long loc : rsmtPinLocs)
   {
-    xCoords.push_back(loc.first);
-    yCoords.push_back(loc.second);
+    xCoords.push_back(unpackX(loc));
+    yCoords.push_back(unpackY(loc));
   }
 }
 
@@ -2097,10 +2249,7 @@ int Net::getNonCritWireLength(bool isBaseline)
 
   if (xCoords.size() > 1)
   {
-    Tree mst = rsmt.fltTree(xCoords, yCoords);
-    int wirelength = rsmt.wirelength(mst);
-    rsmt.free_tree(mst);
-    return wirelength; // v0.6 modify
+    return glbSteinerCache.getWireLength(xCoords.data(), yCoords.data(), xCoords.size()); // v0.6 modify
   }
   else
   {
@@ -2108,6 +2257,23 @@ int Net::getNonCritWireLength(bool isBaseline)
   }
 }
 
+int Net::getCachedWireLength(bool isBaseline)
+{
+  if (!cachedWLValid[isBaseline])
+  {
+    evalWireLength(isBaseline);
+    commitWireLength(isBaseline);
+  }
+  return cachedWL[isBaseline];
+}
+
+// 按当前位置重新计算线长，结果暂存在pendingWL中
+int Net::evalWireLength(bool isBaseline)
+{
+  pendingWL[isBaseline] = getCritWireLength(isBaseline) + getNonCritWireLength(isBaseline);
+  return pendingWL[isBaseline];
+}
+
 int Net::getNonCritHPWL(bool isBaseline) // cjq modify
 {
   int wirelength = 0;
@@ -2,12 +2,15 @@
 #include "global.h"
 #include "object.h"
 #include "pindensity.h"
+#include "tilepin.h"
 #include <fstream>
 
 bool reportPinDensity() {  
   int checkedTileCnt = 0;
 
   // 1) baseline
+  TilePinCounter baselineCounter;
+  baselineCounter.build(true);
   std::multimap<double, Tile*> baselinePinDensityMap;  
   for (int i = 0; i < chip.getNumCol(); i++) {
       for (int j = 0; j < chip.getNumRow(); j++) {
@@ -20,7 +23,7 @@ bool reportPinDensity() {
           }
 
           // baseline
-          int numInterTileConn = tile->getConnectedLutSeqInput(true).size() + tile->getConnectedLutSeqOutput(true).size();          
+          int numInterTileConn = baselineCounter.getPinCount(i, j);          
           double ratio = (double)(numInterTileConn) / (MAX_TILE_PIN_INPUT_COUNT + MAX_TILE_PIN_OUTPUT_COUNT);
           baselinePinDensityMap.insert(std::pair<double, Tile*>(ratio, tile));            
           checkedTileCnt++;
@@ -70,6 +73,8 @@ bool reportPinDensity() {
 
   // 2) optimized
   checkedTileCnt = 0;
+  TilePinCounter optimizedCounter;
+  optimizedCounter.build(false);
   std::multimap<double, Tile*> optimizedPinDensityMap;
     for (int i = 0; i < chip.getNumCol(); i++) {
       for (int j = 0; j < chip.getNumRow(); j++) {
@@ -82,7 +87,7 @@ bool reportPinDensity() {
           }
 
           // optimized
-          int numInterTileConn = tile->getConnectedLutSeqInput(false).size() + tile->getConnectedLutSeqOutput(false).size();          
+          int numInterTileConn = optimizedCounter.getPinCount(i, j);          
           double ratio = (double)(numInterTileConn) / (MAX_TILE_PIN_INPUT_COUNT + MAX_TILE_PIN_OUTPUT_COUNT);
           optimizedPinDensityMap.insert(std::pair<double, Tile*>(ratio, tile));                      
           checkedTileCnt++;
@@ -135,7 +140,8 @@ bool reportPinDensity() {
 //必须计算baseline
 void setPinDensityMapAndTopValues(){
     //设置密度map
-    int checkedTileCnt = 0;
+    std::vector<std::pair<int, int>> values; //第一个是tile x*1000+y 第二个是密度的分子
+    glbTilePinCounter.build(true);
     // 1) baseline
     for (int i = 0; i < chip.getNumCol(); i++) {
         for (int j = 0; j < chip.getNumRow(); j++) {
@@ -148,30 +154,16 @@ void setPinDensityMapAndTopValues(){
             }
 
             // baseline 
-            int numInterTileConn = tile->getConnectedLutSeqInput(true).size() + tile->getConnectedLutSeqOutput(true).size();          
+            int numInterTileConn = glbTilePinCounter.getPinCount(i, j);
             // double ratio = (double)(numInterTileConn) / (MAX_TILE_PIN_INPUT_COUNT + MAX_TILE_PIN_OUTPUT_COUNT);
             int loc = i*1000+j; //x与y组成一个int
-            glbPinDensity.emplace_back(std::make_pair(loc, numInterTileConn));
-            checkedTileCnt++;
+            values.emplace_back(std::make_pair(loc, numInterTileConn));
         }
     }
-    glbTopKNum = checkedTileCnt * 0.05;
-    //排序
-    std::sort(glbPinDensity.begin(), glbPinDensity.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-        return a.second > b.second; // 按值降序排序
-    });
-    //计算初始top5的Conn和
-    int sum = 0;
-    int i = 0;
-    for(auto& it : glbPinDensity){
-        if(i >= glbTopKNum){
-            break;
-        }
-        sum += it.second;
-        i++;
-    }
-    glbInitTopSum = sum;
-
+    glbTopKNum = values.size() * 0.05;
+    glbPinDensity.build(values, glbTopKNum);
+    //初始top5的Conn和
+    glbInitTopSum = glbPinDensity.getTopSum();
 }
 
 //只能获取baseline的  根据x y 获取pin密度的分子
@@ -185,9 +177,81 @@ int getPinDensityByXY(int x, int y){
         return 0;
     }
     // baseline
+    if (glbTilePinCounter.isBuilt(true)) {
+        return glbTilePinCounter.getPinCount(x, y);
+    }
     numInterTileConn = tile->getConnectedLutSeqInput(true).size() + tile->getConnectedLutSeqOutput(true).size();          
     return numInterTileConn;
 }
 
+void PinDensityTracker::build(const std::vector<std::pair<int, int>> &values, int topK){
+    clear();
+    this->topK = topK;
+    for (auto &it : values) {
+        set(it.first, it.second);
+    }
+}
 
+void PinDensityTracker::clear(){
+    topSum = 0;
+    top.clear();
+    rest.clear();
+    valueMap.clear();
+}
 
+int PinDensityTracker::get(int loc) const{
+    auto it = valueMap.find(loc);
+    return it == valueMap.end() ? 0 : it->second;
+}
+
+void PinDensityTracker::set(int loc, int value){
+    auto it = valueMap.find(loc);
+    if (it != valueMap.end()) {
+        if (it->second == value) {
+            return;
+        }
+        eraseValue(it->second);
+        rebalance();
+        it->second = value;
+    }
+    else {
+        valueMap[loc] = value;
+    }
+    insertValue(value);
+    rebalance();
+}
+
+void PinDensityTracker::insertValue(int value){
+    if ((int)top.size() < topK || (!top.empty() && value > *top.begin())) {
+        top.insert(value);
+        topSum += value;
+    }
+    else {
+        rest.insert(value);
+    }
+}
+
+void PinDensityTracker::eraseValue(int value){
+    if (!top.empty() && value >= *top.begin()) {
+        top.erase(top.find(value));
+        topSum -= value;
+    }
+    else {
+        rest.erase(rest.find(value));
+    }
+}
+
+void PinDensityTracker::rebalance(){
+    while ((int)top.size() > topK) {
+        auto it = top.begin();
+        topSum -= *it;
+        rest.insert(*it);
+        top.erase(it);
+    }
+    while ((int)top.size() < topK && !rest.empty()) {
+        auto it = std::prev(rest.end());
+        topSum += *it;
+        top.insert(*it);
+        rest.erase(it);
+    }
+}
@@ -38,7 +38,12 @@
 #include <string>
 #include <algorithm>
 
+#include <stdint.h>
+#include <unistd.h>
+#include <map>
+
 #include "rsmt.h"
+#include "util.h"
 
 #if FLUTE_D <= 7
         #define MGROUP 5040 / 4  // Max. # of groups, 7! = 5040
@@ -56,9 +61,12 @@ int numgrp[10] = {0, 0, 0, 0, 6, 30, 180, 1260, 10080, 90720};
 
 RecSteinerMinTree::RecSteinerMinTree() :
     SteinerLut_(nullptr),
-    numSoln_(nullptr) {
+    numSoln_(nullptr),
+    lutImage_(nullptr) {
 
   accuracy_ = 3;
+  hdModel_ = HD_FLUTE;
+  hdThreshold_ = INT_MAX;
 
   lutInitialDegree_ = 8;
   lutValidDegree_ = 0;
@@ -66,11 +74,56 @@ RecSteinerMinTree::RecSteinerMinTree() :
   readLUT();
 }
 
+RecSteinerMinTree::RecSteinerMinTree(bool loadLUT) :
+    SteinerLut_(nullptr),
+    numSoln_(nullptr),
+    lutImage_(nullptr) {
+
+  accuracy_ = 3;
+  hdModel_ = HD_FLUTE;
+  hdThreshold_ = INT_MAX;
+
+  lutInitialDegree_ = 8;
+  lutValidDegree_ = 0;
+
+  if (loadLUT) {
+    readLUT();
+  } else {
+    makeLUT(SteinerLut_, numSoln_);
+  }
+}
+
 RecSteinerMinTree::~RecSteinerMinTree() {
   deleteLUT();
 }
 
-void RecSteinerMinTree::readLUTfiles() {
+// 查找表文件依次在 $FLUTE_LIB_DIR、可执行文件目录、可执行文件上一级目录、当前目录 下查找
+static std::string findLUTFile(const std::string& defaultPath) {
+  std::string baseName = defaultPath.substr(defaultPath.find_last_of('/') + 1);
+  std::vector<std::string> candidates;
+  const char* libDir = getenv("FLUTE_LIB_DIR");
+  if (libDir != nullptr) {
+    candidates.push_back(std::string(libDir) + "/" + baseName);
+  }
+  char exePath[4096];
+  ssize_t len = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+  if (len > 0) {
+    exePath[len] = '\0';
+    std::string exeDir(exePath);
+    exeDir = exeDir.substr(0, exeDir.find_last_of('/'));
+    candidates.push_back(exeDir + "/" + baseName);
+    candidates.push_back(exeDir + "/" + defaultPath);
+    candidates.push_back(exeDir + "/../" + defaultPath);
+  }
+  for (const std::string& path : candidates) {
+    if (access(path.c_str(), R_OK) == 0) {
+      return path;
+    }
+  }
+  return defaultPath;
+}
+
+bool RecSteinerMinTree::readLUTfiles(const std::string& powvFile, const std::string& postFile) {
   unsigned char charnum[256], line[32], *linep, c;
   FILE *fpwv, *fprt;
   struct csoln *p;
@@ -86,17 +139,18 @@ void RecSteinerMinTree::readLUTfiles() {
       charnum[i] = 0;
   }
 
-  fpwv = fopen(FLUTE_POWVFILE, "r");
+  fpwv = fopen(powvFile.c_str(), "r");
   if (fpwv == NULL) {
-    printf("Error in opening %s\n", FLUTE_POWVFILE);
-    exit(1);
+    printf("Error in opening %s\n", powvFile.c_str());
+    return false;
   }
 
 #if FLUTE_ROUTING == 1
-  fprt = fopen(FLUTE_POSTFILE, "r");
+  fprt = fopen(postFile.c_str(), "r");
   if (fprt == NULL) {
-    printf("Error in opening %s\n", FLUTE_POSTFILE);
-    exit(1);
+    printf("Error in opening %s\n", postFile.c_str());
+    fclose(fpwv);
+    return false;
   }
 #endif
 
@@ -134,7 +188,7 @@ void RecSteinerMinTree::readLUTfiles() {
       } else {
         fgetc(fpwv);  // '\n'
         numSoln_[d][k] = ns;
-        p = (struct csoln *) malloc(ns * sizeof(struct csoln));
+        p = (struct csoln *) calloc(ns, sizeof(struct csoln));  // 清零，未用到的seg不留垃圾值
         if (p == nullptr) {
             continue;
         }
@@ -175,6 +229,121 @@ void RecSteinerMinTree::readLUTfiles() {
 #if FLUTE_ROUTING == 1
   fclose(fprt);
 #endif
+  return true;
+}
+
+/*
+二进制查找表镜像，由flute_lut_convert从POWV9.dat/POST9.dat生成
+1、LutImageHeader
+2、d = 4..FLUTE_D 每组一个 [numsoln, 在csoln数组中的下标]，与之前某组相同的组共享下标
+3、所有csoln，csoln只含unsigned char，SteinerLut_直接指向镜像内存，不需要拷贝
+*/
+struct LutImageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t fluteD;
+  uint32_t routing;
+  uint32_t solnSize;  // sizeof(csoln)，不同编译参数下不通用
+  uint32_t numSoln;   // csoln总数
+  uint32_t reserved;
+};
+
+static const char LUT_IMAGE_MAGIC[8] = {'F', 'L', 'U', 'T', 'E', 'L', 'U', 'T'};
+static const uint32_t LUT_IMAGE_VERSION = 1;
+
+bool RecSteinerMinTree::loadLUTImage(const unsigned char* data, size_t size) {
+  LutImageHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, LUT_IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != LUT_IMAGE_VERSION || header.fluteD != FLUTE_D ||
+      header.routing != FLUTE_ROUTING || header.solnSize != sizeof(struct csoln)) {
+    return false;
+  }
+  size_t numGroups = 0;
+  for (int d = 4; d <= FLUTE_D; d++) {
+    numGroups += numgrp[d];
+  }
+  size_t indexSize = numGroups * 2 * sizeof(int32_t);
+  if (size != sizeof(header) + indexSize + (size_t)header.numSoln * sizeof(struct csoln)) {
+    return false;
+  }
+  const unsigned char* index = data + sizeof(header);
+  struct csoln* solns = (struct csoln*)(data + sizeof(header) + indexSize);
+  for (int d = 4; d <= FLUTE_D; d++) {
+    for (int k = 0; k < numgrp[d]; k++) {
+      int32_t entry[2];
+      memcpy(entry, index, sizeof(entry));
+      index += sizeof(entry);
+      if (entry[0] <= 0 || entry[1] < 0 || (uint32_t)entry[1] + (uint32_t)entry[0] > header.numSoln) {
+        return false;
+      }
+      numSoln_[d][k] = entry[0];
+      SteinerLut_[d][k] = solns + entry[1];
+    }
+  }
+  lutValidDegree_ = FLUTE_D;
+  return true;
+}
+
+bool RecSteinerMinTree::loadLUTImageFile(const std::string& fileName) {
+  MappedFile* image = new MappedFile(fileName);
+  if (!image->isOpen() || !loadLUTImage((const unsigned char*)image->begin(), image->size())) {
+    delete image;
+    return false;
+  }
+  lutImage_ = image;
+  return true;
+}
+
+bool RecSteinerMinTree::loadLUTText(const std::string& powvFile, const std::string& postFile) {
+  deleteLUT();
+  makeLUT(SteinerLut_, numSoln_);
+  if (!readLUTfiles(powvFile, postFile)) {
+    return false;
+  }
+  lutValidDegree_ = FLUTE_D;
+  return true;
+}
+
+bool RecSteinerMinTree::writeLUTImage(std::string& image) const {
+  if (lutValidDegree_ < FLUTE_D) {
+    return false;
+  }
+  // 共享同一组解的group只保存一次
+  std::map<const struct csoln*, uint32_t> solnIndex;
+  std::vector<int32_t> index;
+  std::string solnData;
+  uint32_t numSoln = 0;
+  for (int d = 4; d <= FLUTE_D; d++) {
+    for (int k = 0; k < numgrp[d]; k++) {
+      const struct csoln* p = SteinerLut_[d][k];
+      int ns = numSoln_[d][k];
+      auto it = solnIndex.find(p);
+      if (it == solnIndex.end()) {
+        it = solnIndex.insert(std::make_pair(p, numSoln)).first;
+        solnData.append((const char*)p, ns * sizeof(struct csoln));
+        numSoln += ns;
+      }
+      index.push_back(ns);
+      index.push_back(it->second);
+    }
+  }
+
+  LutImageHeader header;
+  memcpy(header.magic, LUT_IMAGE_MAGIC, sizeof(header.magic));
+  header.version = LUT_IMAGE_VERSION;
+  header.fluteD = FLUTE_D;
+  header.routing = FLUTE_ROUTING;
+  header.solnSize = sizeof(struct csoln);
+  header.numSoln = numSoln;
+  header.reserved = 0;
+  image.assign((const char*)&header, sizeof(header));
+  image.append((const char*)index.data(), index.size() * sizeof(int32_t));
+  image.append(solnData);
+  return true;
 }
 
 void RecSteinerMinTree::readLUT() {
@@ -182,7 +351,25 @@ void RecSteinerMinTree::readLUT() {
   makeLUT(SteinerLut_, numSoln_);
 
 #if LUT_SOURCE==LUT_FILE
-  readLUTfiles();
+  if (!readLUTfiles(findLUTFile(FLUTE_POWVFILE), findLUTFile(FLUTE_POSTFILE))) {
+    exit(1);
+  }
+  lutValidDegree_ = FLUTE_D;
+
+#elif LUT_SOURCE==LUT_BIN
+#ifdef FLUTE_EMBED_LUT
+  if (loadLUTImage(fluteLutImage, fluteLutImageSize)) {
+    return;
+  }
+  printf("Embedded FLUTE LUT image does not match this build\n");
+#endif
+  if (loadLUTImageFile(findLUTFile(FLUTE_LUTIMAGE))) {
+    return;
+  }
+  // 没有二进制镜像时退回文本文件
+  if (!readLUTfiles(findLUTFile(FLUTE_POWVFILE), findLUTFile(FLUTE_POSTFILE))) {
+    exit(1);
+  }
   lutValidDegree_ = FLUTE_D;
 
 #elif LUT_SOURCE==LUT_VAR
@@ -190,7 +377,7 @@ void RecSteinerMinTree::readLUT() {
   initLUT(lutInitialDegree_, SteinerLut_, numSoln_);
 
 #elif LUT_SOURCE==LUT_VAR_CHECK
-  readLUTfiles(SteinerLut_, numSoln_);
+  readLUTfiles(findLUTFile(FLUTE_POWVFILE), findLUTFile(FLUTE_POSTFILE));
   // Temporaries to compare to file results.
   LUT_TYPE LUT;
   NUMSOLN_TYPE numsoln;
@@ -214,6 +401,11 @@ void RecSteinerMinTree::makeLUT(
 
 void RecSteinerMinTree::deleteLUT() {
   deleteLUT(SteinerLut_, numSoln_);
+  SteinerLut_ = nullptr;
+  numSoln_ = nullptr;
+  delete lutImage_;
+  lutImage_ = nullptr;
+  lutValidDegree_ = 0;
 }
 
 void RecSteinerMinTree::deleteLUT(
@@ -227,6 +419,9 @@ void RecSteinerMinTree::deleteLUT(
   }
   memTracker_.clear();
 
+  if (LUT == nullptr) {
+    return;
+  }
   for (int d = 4; d <= FLUTE_D; d++) {
     delete [] LUT[d];
     delete [] numsoln[d];
@@ -958,13 +1153,89 @@ int RecSteinerMinTree::ordery(const void *a, const void *b) {
         return 0;
 }
 
+void FluteScratch::reserve(int d) {
+  if ((int)xs.size() < d) {
+    xs.resize(d);
+    ys.resize(d);
+    s.resize(d);
+  }
+  if ((int)pt.size() < d + 1) {
+    pt.resize(d + 1);
+    ptp.resize(d + 1);
+  }
+}
+
+void RecSteinerMinTree::sortPins(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch) {
+  DTYPE minval;
+  int i, j, minidx;
+  struct point *tmpp;
+
+  scratch.reserve(d);
+  DTYPE *xs = scratch.xs.data();
+  DTYPE *ys = scratch.ys.data();
+  int *s = scratch.s.data();
+  struct point *pt = scratch.pt.data();
+  struct point **ptp = scratch.ptp.data();
+
+  for (i = 0; i < d; i++) {
+          pt[i].x = x[i];
+          pt[i].y = y[i];
+          ptp[i] = &pt[i];
+  }
+
+  // sort x
+  if (d < 200) {
+          for (i = 0; i < d - 1; i++) {
+                  minval = ptp[i]->x;
+                  minidx = i;
+                  for (j = i + 1; j < d; j++) {
+                          if (minval > ptp[j]->x) {
+                                  minval = ptp[j]->x;
+                                  minidx = j;
+                          }
+                  }
+                  tmpp = ptp[i];
+                  ptp[i] = ptp[minidx];
+                  ptp[minidx] = tmpp;
+          }
+  } else {
+          qsort(ptp, d, sizeof(struct point *), orderx);
+  }
+
+  for (i = 0; i < d; i++) {
+          xs[i] = ptp[i]->x;
+          ptp[i]->o = i;
+  }
+
+  // sort y to find s[]
+  if (d < 200) {
+          for (i = 0; i < d - 1; i++) {
+                  minval = ptp[i]->y;
+                  minidx = i;
+                  for (j = i + 1; j < d; j++) {
+                          if (minval > ptp[j]->y) {
+                                  minval = ptp[j]->y;
+                                  minidx = j;
+                          }
+                  }
+                  ys[i] = ptp[minidx]->y;
+                  s[i] = ptp[minidx]->o;
+                  ptp[minidx] = ptp[i];
+          }
+          ys[d - 1] = ptp[d - 1]->y;
+          s[d - 1] = ptp[d - 1]->o;
+  } else {
+          qsort(ptp, d, sizeof(struct point *), ordery);
+          for (i = 0; i < d; i++) {
+                  ys[i] = ptp[i]->y;
+                  s[i] = ptp[i]->o;
+          }
+  }
+}
+
 Tree RecSteinerMinTree::fltTree(
     std::vector<DTYPE>& x,
     std::vector<DTYPE>& y) {
-  DTYPE *xs, *ys, minval;
-  int *s;
-  int i, j, minidx;
-  struct point *pt, **ptp, *tmpp;
   Tree t;
 
   int acc = accuracy_;
@@ -983,91 +1254,144 @@ Tree RecSteinerMinTree::fltTree(
   } else {
           ensureLUT(d);
 
-          xs = (DTYPE *)malloc(sizeof(DTYPE) * (d));
-          ys = (DTYPE *)malloc(sizeof(DTYPE) * (d));
-          s = (int *)malloc(sizeof(int) * (d));
-          pt = (struct point *)malloc(sizeof(struct point) * (d + 1));
-          ptp = (struct point **)malloc(sizeof(struct point *) * (d + 1));
+          static thread_local FluteScratch scratch;
+          sortPins(x.data(), y.data(), d, scratch);
+          t = flutes(d, scratch.xs.data(), scratch.ys.data(), scratch.s.data(), acc);
+  }
+  return t;
+}
 
+DTYPE RecSteinerMinTree::treeWireLength(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch) {
+  if (d < 2) {
+          return 0;
+  }
+  if (d == 2) {
+          return ADIFF(x[0], x[1]) + ADIFF(y[0], y[1]);
+  }
+  if (!isExact(d)) {
+          return rmstWireLength(x, y, d, scratch);
+  }
+  ensureLUT(d);
+  sortPins(x, y, d, scratch);
+  if (d <= FLUTE_D) {
+          // 低度数net的树就是查找表中的最短解，树长等于minl
+          return flutes_wl_LD(d, scratch.xs.data(), scratch.ys.data(), scratch.s.data());
+  }
+  // 高度数net的树经过合并与local refinement，只能建树后求长度
+  Tree t = flutes(d, scratch.xs.data(), scratch.ys.data(), scratch.s.data(), accuracy_);
+  DTYPE l = wirelength(t);
+  free_tree(t);
+  return l;
+}
 
-          for (i = 0; i < d; i++) {
-                  pt[i].x = x[i];
-                  pt[i].y = y[i];
-                  ptp[i] = &pt[i];
-          }
+DTYPE RecSteinerMinTree::treeWireLength(const DTYPE* x, const DTYPE* y, int d) {
+  static thread_local FluteScratch scratch;
+  return treeWireLength(x, y, d, scratch);
+}
 
-          // sort x
-          if (d < 200) {
-                  for (i = 0; i < d - 1; i++) {
-                          minval = ptp[i]->x;
-                          minidx = i;
-                          for (j = i + 1; j < d; j++) {
-                                  if (minval > ptp[j]->x) {
-                                          minval = ptp[j]->x;
-                                          minidx = j;
-                                  }
+void RecSteinerMinTree::setHighDegreeModel(HighDegreeModel model, int threshold) {
+  hdModel_ = model;
+  hdThreshold_ = std::max(threshold, FLUTE_D);
+}
+
+static int findRoot(std::vector<int>& parent, int u) {
+  while (parent[u] != u) {
+          parent[u] = parent[parent[u]];
+          u = parent[u];
+  }
+  return u;
+}
+
+// 直角最小生成树的长度
+// 每个点只需连向它8个45度扇区中各自最近的点。分4次坐标变换，每次按(x,y)从大到小加入点，
+// 用按y-x离散化的树状数组查出y-x不小于当前点的点中x+y最小的一个，得到至多4d条候选边，再用Kruskal求MST
+// 所有数组都在scratch中复用，调用之间不分配内存
+DTYPE RecSteinerMinTree::rmstWireLength(const DTYPE* x, const DTYPE* y, int d, FluteScratch& scratch) {
+  if (d < 2) {
+          return 0;
+  }
+  std::vector<DTYPE>& px = scratch.px;
+  std::vector<DTYPE>& py = scratch.py;
+  std::vector<int>& order = scratch.order;
+  std::vector<DTYPE>& keys = scratch.keys;
+  std::vector<DTYPE>& bitVal = scratch.bitVal;
+  std::vector<int>& bitIdx = scratch.bitIdx;
+  auto& edges = scratch.edges;
+  px.assign(x, x + d);
+  py.assign(y, y + d);
+  order.resize(d);
+  keys.resize(d);
+  bitVal.resize(d + 1);
+  bitIdx.resize(d + 1);
+  edges.clear();
+  for (int k = 0; k < 4; k++) {
+          // 依次变换坐标，覆盖另外的扇区
+          for (int i = 0; i < d; i++) {
+                  if (k == 1 || k == 3) {
+                          std::swap(px[i], py[i]);
+                  } else if (k == 2) {
+                          px[i] = -px[i];
+                  }
+          }
+          for (int i = 0; i < d; i++) {
+                  order[i] = i;
+                  keys[i] = py[i] - px[i];
+          }
+          std::sort(order.begin(), order.end(), [&](int i, int j) {
+                  return px[i] < px[j] || (px[i] == px[j] && py[i] < py[j]);
+          });
+          std::sort(keys.begin(), keys.end());
+          int m = std::unique(keys.begin(), keys.end()) - keys.begin();
+          for (int p = 1; p <= m; p++) {
+                  bitVal[p] = INT_MAX;
+                  bitIdx[p] = -1;
+          }
+          for (int t = d - 1; t >= 0; t--) {
+                  int i = order[t];
+                  // y-x越大位置越靠前，前缀即y-x不小于当前点的部分
+                  int pos = m - (std::lower_bound(keys.begin(), keys.begin() + m, py[i] - px[i]) - keys.begin());
+                  DTYPE best = INT_MAX;
+                  int j = -1;
+                  for (int p = pos; p > 0; p -= p & -p) {
+                          if (bitVal[p] < best) {
+                                  best = bitVal[p];
+                                  j = bitIdx[p];
+                          }
+                  }
+                  if (j != -1) {
+                          edges.push_back(std::make_pair(best - px[i] - py[i], std::make_pair(i, j)));
+                  }
+                  DTYPE v = px[i] + py[i];
+                  for (int p = pos; p <= m; p += p & -p) {
+                          if (v < bitVal[p]) {
+                                  bitVal[p] = v;
+                                  bitIdx[p] = i;
                           }
-                          tmpp = ptp[i];
-                          ptp[i] = ptp[minidx];
-                          ptp[minidx] = tmpp;
                   }
-          } else {
-                  qsort(ptp, d, sizeof(struct point *), orderx);
           }
+  }
 
-#if FLUTE_REMOVE_DUPLICATE_PIN == 1
-                ptp[d] = &pt[d];
-                ptp[d]->x = ptp[d]->y = -999999;
-                j = 0;
-                for (i = 0; i < d; i++) {
-                        for (k = i + 1; ptp[k]->x == ptp[i]->x; k++)
-                                if (ptp[k]->y == ptp[i]->y)  // pins k and i are the same
-                                        break;
-                        if (ptp[k]->x != ptp[i]->x)
-                                ptp[j++] = ptp[i];
-                }
-                d = j;
-#endif
-
-    for (i = 0; i < d; i++) {
-            xs[i] = ptp[i]->x;
-            ptp[i]->o = i;
-    }
-
-    // sort y to find s[]
-    if (d < 200) {
-            for (i = 0; i < d - 1; i++) {
-                    minval = ptp[i]->y;
-                    minidx = i;
-                    for (j = i + 1; j < d; j++) {
-                            if (minval > ptp[j]->y) {
-                                    minval = ptp[j]->y;
-                                    minidx = j;
-                            }
-                    }
-                    ys[i] = ptp[minidx]->y;
-                    s[i] = ptp[minidx]->o;
-                    ptp[minidx] = ptp[i];
-            }
-            ys[d - 1] = ptp[d - 1]->y;
-            s[d - 1] = ptp[d - 1]->o;
-    } else {
-            qsort(ptp, d, sizeof(struct point *), ordery);
-            for (i = 0; i < d; i++) {
-                    ys[i] = ptp[i]->y;
-                    s[i] = ptp[i]->o;
-            }
-    }
-
-    t = flutes(d, xs, ys, s, acc);
-
-    free(xs);
-    free(ys);
-    free(s);
-    free(pt);
-    free(ptp);
+  std::sort(edges.begin(), edges.end());
+  std::vector<int>& parent = scratch.parent;
+  parent.resize(d);
+  for (int i = 0; i < d; i++) {
+          parent[i] = i;
   }
-  return t;
+  DTYPE length = 0;
+  int joined = 1;
+  for (const auto& e : edges) {
+          int u = findRoot(parent, e.second.first);
+          int v = findRoot(parent, e.second.second);
+          if (u == v) {
+                  continue;
+          }
+          parent[u] = v;
+          length += e.first;
+          if (++joined == d) {
+                  break;
+          }
+  }
+  return length;
 }
 
 // xs[] and ys[] are coords in x and y in sorted order
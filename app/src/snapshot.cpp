@@ -0,0 +1,614 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include "global.h"
+#include "util.h"
+#include "snapshot.h"
+
+namespace
+{
+    const char SNAPSHOT_MAGIC[8] = {'E', 'D', 'A', 'S', 'N', 'A', 'P', '\0'};
+    const uint32_t SNAPSHOT_VERSION = 1;
+
+    // 对文件内容做FNV-1a hash，打不开返回false
+    bool hashFile(const std::string &fileName, uint64_t &hash)
+    {
+        MappedFile file(fileName);
+        if (!file.isOpen())
+        {
+            return false;
+        }
+        hash = 14695981039346656037ULL;
+        for (const char *p = file.begin(); p != file.end(); p++)
+        {
+            hash ^= (unsigned char)*p;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= file.size();
+        return true;
+    }
+
+    class SnapshotWriter
+    {
+    public:
+        void putU8(uint8_t v) { buf.push_back((char)v); }
+        void putI32(int32_t v) { buf.append((const char *)&v, sizeof(v)); }
+        void putU32(uint32_t v) { buf.append((const char *)&v, sizeof(v)); }
+        void putU64(uint64_t v) { buf.append((const char *)&v, sizeof(v)); }
+        void putStr(const std::string &s)
+        {
+            putU32(s.size());
+            buf.append(s);
+        }
+        void putRaw(const char *p, size_t n) { buf.append(p, n); }
+        const std::string &data() const { return buf; }
+
+    private:
+        std::string buf;
+    };
+
+    // 顺序读快照，越界后ok置为false，之后的读取都返回0
+    class SnapshotReader
+    {
+    public:
+        SnapshotReader(const char *begin, const char *end) : cur(begin), end(end) {}
+
+        bool isOk() const { return ok; }
+        bool atEnd() const { return cur == end; }
+
+        uint8_t getU8()
+        {
+            uint8_t v = 0;
+            get(&v, sizeof(v));
+            return v;
+        }
+        int32_t getI32()
+        {
+            int32_t v = 0;
+            get(&v, sizeof(v));
+            return v;
+        }
+        uint32_t getU32()
+        {
+            uint32_t v = 0;
+            get(&v, sizeof(v));
+            return v;
+        }
+        uint64_t getU64()
+        {
+            uint64_t v = 0;
+            get(&v, sizeof(v));
+            return v;
+        }
+        std::string getStr()
+        {
+            uint32_t n = getU32();
+            if (!ok || n > (size_t)(end - cur))
+            {
+                ok = false;
+                return std::string();
+            }
+            std::string s(cur, n);
+            cur += n;
+            return s;
+        }
+        // 读元素个数，每个元素至少占minBytes字节，用于在分配前拦截损坏的计数
+        uint32_t getCount(size_t minBytes)
+        {
+            uint32_t n = getU32();
+            if (ok && (uint64_t)n * minBytes > (uint64_t)(end - cur))
+            {
+                ok = false;
+                return 0;
+            }
+            return ok ? n : 0;
+        }
+        bool getRaw(char *p, size_t n) { return get(p, n); }
+
+    private:
+        const char *cur;
+        const char *end;
+        bool ok = true;
+
+        bool get(void *p, size_t n)
+        {
+            if (!ok || n > (size_t)(end - cur))
+            {
+                ok = false;
+                return false;
+            }
+            memcpy(p, cur, n);
+            cur += n;
+            return true;
+        }
+    };
+
+    struct SnapLib
+    {
+        std::string name;
+        std::vector<std::pair<std::string, int>> inputs;
+        std::vector<std::pair<std::string, int>> outputs;
+    };
+
+    struct SnapInst
+    {
+        int id;
+        std::string name;
+        std::string model;
+        int x, y, z;
+        bool fixed;
+        std::vector<uint8_t> inCrit;
+        std::vector<uint8_t> outCrit;
+    };
+
+    struct SnapNet
+    {
+        int id;
+        bool clock;
+        int driverInst;
+        int driverPin; // -1 表示没有driver
+        std::vector<std::pair<int, int>> sinks; // [instID, 输入pin下标]
+    };
+
+    struct SnapClockRegion
+    {
+        std::string name;
+        int left, right, bottom, top;
+    };
+
+    struct SnapDesign
+    {
+        std::vector<SnapLib> libs;
+        int numCol = 0, numRow = 0, numClockCol = 0, numClockRow = 0;
+        std::vector<std::vector<std::string>> tileTypes; // x*numRow+y
+        std::vector<SnapClockRegion> clockRegions;       // x*numClockRow+y
+        std::vector<SnapInst> insts;
+        std::vector<SnapNet> nets;
+    };
+
+    bool readHeader(SnapshotReader &reader, const std::vector<uint64_t> &hashes)
+    {
+        char magic[sizeof(SNAPSHOT_MAGIC)];
+        if (!reader.getRaw(magic, sizeof(magic)) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+        {
+            return false;
+        }
+        if (reader.getU32() != SNAPSHOT_VERSION)
+        {
+            return false;
+        }
+        if (reader.getU32() != hashes.size())
+        {
+            return false;
+        }
+        for (uint64_t hash : hashes)
+        {
+            if (reader.getU64() != hash)
+            {
+                return false;
+            }
+        }
+        return reader.isOk();
+    }
+
+    bool decodeDesign(SnapshotReader &reader, SnapDesign &design)
+    {
+        uint32_t numLibs = reader.getCount(12);
+        design.libs.resize(numLibs);
+        for (SnapLib &lib : design.libs)
+        {
+            lib.name = reader.getStr();
+            lib.inputs.resize(reader.getCount(8));
+            for (auto &pin : lib.inputs)
+            {
+                pin.first = reader.getStr();
+                pin.second = reader.getI32();
+            }
+            lib.outputs.resize(reader.getCount(8));
+            for (auto &pin : lib.outputs)
+            {
+                pin.first = reader.getStr();
+                pin.second = reader.getI32();
+            }
+        }
+
+        design.numCol = reader.getI32();
+        design.numRow = reader.getI32();
+        design.numClockCol = reader.getI32();
+        design.numClockRow = reader.getI32();
+        if (!reader.isOk() || design.numCol < 0 || design.numRow < 0 || design.numClockCol < 0 || design.numClockRow < 0)
+        {
+            return false;
+        }
+        uint32_t numTiles = reader.getCount(4);
+        if (numTiles != (uint64_t)design.numCol * design.numRow)
+        {
+            return false;
+        }
+        design.tileTypes.resize(numTiles);
+        for (auto &types : design.tileTypes)
+        {
+            types.resize(reader.getCount(4));
+            for (std::string &type : types)
+            {
+                type = reader.getStr();
+            }
+        }
+        uint32_t numRegions = reader.getCount(20);
+        if (numRegions != (uint64_t)design.numClockCol * design.numClockRow)
+        {
+            return false;
+        }
+        design.clockRegions.resize(numRegions);
+        for (SnapClockRegion &region : design.clockRegions)
+        {
+            region.name = reader.getStr();
+            region.left = reader.getI32();
+            region.right = reader.getI32();
+            region.bottom = reader.getI32();
+            region.top = reader.getI32();
+        }
+
+        design.insts.resize(reader.getCount(33));
+        for (SnapInst &inst : design.insts)
+        {
+            inst.id = reader.getI32();
+            inst.name = reader.getStr();
+            inst.model = reader.getStr();
+            inst.x = reader.getI32();
+            inst.y = reader.getI32();
+            inst.z = reader.getI32();
+            inst.fixed = reader.getU8() != 0;
+            inst.inCrit.resize(reader.getCount(1));
+            for (uint8_t &crit : inst.inCrit)
+            {
+                crit = reader.getU8();
+            }
+            inst.outCrit.resize(reader.getCount(1));
+            for (uint8_t &crit : inst.outCrit)
+            {
+                crit = reader.getU8();
+            }
+        }
+
+        design.nets.resize(reader.getCount(17));
+        for (SnapNet &net : design.nets)
+        {
+            net.id = reader.getI32();
+            net.clock = reader.getU8() != 0;
+            net.driverInst = reader.getI32();
+            net.driverPin = reader.getI32();
+            net.sinks.resize(reader.getCount(8));
+            for (auto &sink : net.sinks)
+            {
+                sink.first = reader.getI32();
+                sink.second = reader.getI32();
+            }
+        }
+        return reader.isOk() && reader.atEnd();
+    }
+
+    // 与readAndCreateLib/readArch/readInputNodes/readInputNets/readInputTiming建立相同的数据
+    bool buildDesign(const SnapDesign &design)
+    {
+        for (const SnapLib &snapLib : design.libs)
+        {
+            Lib *lib = new Lib(snapLib.name);
+            lib->setNumInputs(snapLib.inputs.size());
+            for (size_t i = 0; i < snapLib.inputs.size(); i++)
+            {
+                lib->setInput(i, snapLib.inputs[i].first, (PinProp)snapLib.inputs[i].second);
+            }
+            lib->setNumOutputs(snapLib.outputs.size());
+            for (size_t i = 0; i < snapLib.outputs.size(); i++)
+            {
+                lib->setOutput(i, snapLib.outputs[i].first, (PinProp)snapLib.outputs[i].second);
+            }
+            glbLibMap[snapLib.name] = lib;
+        }
+
+        chip.createGrid(design.numCol, design.numRow, design.numClockCol, design.numClockRow);
+        for (int x = 0; x < design.numCol; x++)
+        {
+            for (int y = 0; y < design.numRow; y++)
+            {
+                Tile *tile = chip.getTile(x, y);
+                for (const std::string &type : design.tileTypes[x * design.numRow + y])
+                {
+                    if (type == "UNDEFINED")
+                    {
+                        tile->addType(type);
+                    }
+                    else if (tile->initTile(type) == false)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        for (int x = 0; x < design.numClockCol; x++)
+        {
+            for (int y = 0; y < design.numClockRow; y++)
+            {
+                const SnapClockRegion &region = design.clockRegions[x * design.numClockRow + y];
+                ClockRegion *clockRegion = chip.getClockRegion(x, y);
+                clockRegion->setRegionName(region.name);
+                clockRegion->setBoundingBox(region.left, region.right, region.bottom, region.top);
+            }
+        }
+
+        for (const SnapInst &snapInst : design.insts)
+        {
+            auto libIt = glbLibMap.find(snapInst.model);
+            if (libIt == glbLibMap.end() || snapInst.x < 0 || snapInst.x >= design.numCol || snapInst.y < 0 || snapInst.y >= design.numRow)
+            {
+                return false;
+            }
+            Instance *inst = new Instance();
+            inst->setInstanceName(snapInst.name);
+            inst->setModelName(snapInst.model);
+            inst->setBaseLocation(std::make_tuple(snapInst.x, snapInst.y, snapInst.z));
+            inst->setFixed(snapInst.fixed);
+            inst->setCellLib(libIt->second);
+            inst->setInstID(snapInst.id);
+            glbInstMap[snapInst.id] = inst;
+            if ((int)snapInst.inCrit.size() != inst->getNumInpins() || (int)snapInst.outCrit.size() != inst->getNumOutpins())
+            {
+                return false;
+            }
+            for (int i = 0; i < inst->getNumInpins(); i++)
+            {
+                inst->getInpin(i)->setTimingCritical(snapInst.inCrit[i] != 0);
+            }
+            for (int i = 0; i < inst->getNumOutpins(); i++)
+            {
+                inst->getOutpin(i)->setTimingCritical(snapInst.outCrit[i] != 0);
+            }
+            if (chip.getTile(snapInst.x, snapInst.y)->addInstance(snapInst.id, snapInst.z, snapInst.model, true) == false)
+            {
+                return false;
+            }
+        }
+
+        for (const SnapNet &snapNet : design.nets)
+        {
+            Net *net = new Net(snapNet.id);
+            net->setClock(snapNet.clock);
+            glbNetMap[snapNet.id] = net;
+            if (snapNet.driverPin >= 0)
+            {
+                auto it = glbInstMap.find(snapNet.driverInst);
+                if (it == glbInstMap.end() || snapNet.driverPin >= it->second->getNumOutpins())
+                {
+                    return false;
+                }
+                Pin *pin = it->second->getOutpin(snapNet.driverPin);
+                pin->setNetID(snapNet.id);
+                net->setInpin(pin);
+            }
+            for (const auto &sink : snapNet.sinks)
+            {
+                auto it = glbInstMap.find(sink.first);
+                if (it == glbInstMap.end() || sink.second < 0 || sink.second >= it->second->getNumInpins())
+                {
+                    return false;
+                }
+                Pin *pin = it->second->getInpin(sink.second);
+                pin->setNetID(snapNet.id);
+                net->addOutputPin(pin);
+            }
+        }
+        return true;
+    }
+
+    void clearDesign()
+    {
+        for (auto &lib : glbLibMap)
+        {
+            delete lib.second;
+        }
+        glbLibMap.clear();
+        for (auto &inst : glbInstMap)
+        {
+            delete inst.second;
+        }
+        glbInstMap.clear();
+        for (auto &net : glbNetMap)
+        {
+            delete net.second;
+        }
+        glbNetMap.clear();
+        chip.clearGrid();
+    }
+
+    bool hashInputs(const std::vector<std::string> &inputFiles, std::vector<uint64_t> &hashes)
+    {
+        hashes.resize(inputFiles.size());
+        for (size_t i = 0; i < inputFiles.size(); i++)
+        {
+            if (!hashFile(inputFiles[i], hashes[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool loadSnapshot(const std::string &snapFile, const std::vector<std::string> &inputFiles)
+{
+    if (!glbLibMap.empty() || !glbInstMap.empty() || chip.getNumCol() != 0)
+    {
+        std::cout << "Snapshot must be loaded before reading arch and design files" << std::endl;
+        return false;
+    }
+    MappedFile file(snapFile);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+    std::vector<uint64_t> hashes;
+    if (!hashInputs(inputFiles, hashes))
+    {
+        return false;
+    }
+    SnapshotReader reader(file.begin(), file.end());
+    if (!readHeader(reader, hashes))
+    {
+        std::cout << "  Snapshot " << snapFile << " is out of date" << std::endl;
+        return false;
+    }
+    SnapDesign design;
+    if (!decodeDesign(reader, design))
+    {
+        std::cout << "  Snapshot " << snapFile << " is corrupted" << std::endl;
+        return false;
+    }
+    if (!buildDesign(design))
+    {
+        std::cout << "Error: Failed to rebuild design from snapshot " << snapFile << std::endl;
+        clearDesign();
+        return false;
+    }
+    return true;
+}
+
+bool saveSnapshot(const std::string &snapFile, const std::vector<std::string> &inputFiles)
+{
+    std::vector<uint64_t> hashes;
+    if (!hashInputs(inputFiles, hashes))
+    {
+        std::cout << "Failed to hash input files for snapshot" << std::endl;
+        return false;
+    }
+
+    SnapshotWriter writer;
+    writer.putRaw(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writer.putU32(SNAPSHOT_VERSION);
+    writer.putU32(hashes.size());
+    for (uint64_t hash : hashes)
+    {
+        writer.putU64(hash);
+    }
+
+    writer.putU32(glbLibMap.size());
+    for (auto &iter : glbLibMap)
+    {
+        Lib *lib = iter.second;
+        writer.putStr(lib->getName());
+        const auto inputs = lib->getInputs();
+        writer.putU32(inputs.size());
+        for (auto &pin : inputs)
+        {
+            writer.putStr(pin.first);
+            writer.putI32(pin.second);
+        }
+        const auto outputs = lib->getOutputs();
+        writer.putU32(outputs.size());
+        for (auto &pin : outputs)
+        {
+            writer.putStr(pin.first);
+            writer.putI32(pin.second);
+        }
+    }
+
+    writer.putI32(chip.getNumCol());
+    writer.putI32(chip.getNumRow());
+    writer.putI32(chip.getNumClockCol());
+    writer.putI32(chip.getNumClockRow());
+    writer.putU32(chip.getNumCol() * chip.getNumRow());
+    for (int x = 0; x < chip.getNumCol(); x++)
+    {
+        for (int y = 0; y < chip.getNumRow(); y++)
+        {
+            const std::set<std::string> types = chip.getTile(x, y)->getTileTypes();
+            writer.putU32(types.size());
+            for (const std::string &type : types)
+            {
+                writer.putStr(type);
+            }
+        }
+    }
+    writer.putU32(chip.getNumClockCol() * chip.getNumClockRow());
+    for (int x = 0; x < chip.getNumClockCol(); x++)
+    {
+        for (int y = 0; y < chip.getNumClockRow(); y++)
+        {
+            ClockRegion *region = chip.getClockRegion(x, y);
+            writer.putStr(region->getRegionName());
+            writer.putI32(region->getXLeft());
+            writer.putI32(region->getXRight());
+            writer.putI32(region->getYBottom());
+            writer.putI32(region->getYTop());
+        }
+    }
+
+    // pin在所属inst上的下标，用于保存net连接
+    std::unordered_map<Pin *, int> pinIndex;
+    writer.putU32(glbInstMap.size());
+    for (auto &iter : glbInstMap)
+    {
+        Instance *inst = iter.second;
+        int x, y, z;
+        std::tie(x, y, z) = inst->getBaseLocation();
+        writer.putI32(iter.first);
+        writer.putStr(inst->getInstanceName());
+        writer.putStr(inst->getModelName());
+        writer.putI32(x);
+        writer.putI32(y);
+        writer.putI32(z);
+        writer.putU8(inst->isFixed());
+        writer.putU32(inst->getNumInpins());
+        for (int i = 0; i < inst->getNumInpins(); i++)
+        {
+            Pin *pin = inst->getInpin(i);
+            writer.putU8(pin->getTimingCritical());
+            pinIndex[pin] = i;
+        }
+        writer.putU32(inst->getNumOutpins());
+        for (int i = 0; i < inst->getNumOutpins(); i++)
+        {
+            Pin *pin = inst->getOutpin(i);
+            writer.putU8(pin->getTimingCritical());
+            pinIndex[pin] = i;
+        }
+    }
+
+    writer.putU32(glbNetMap.size());
+    for (auto &iter : glbNetMap)
+    {
+        Net *net = iter.second;
+        writer.putI32(iter.first);
+        writer.putU8(net->isClock());
+        Pin *driver = net->getInpin();
+        writer.putI32(driver == nullptr ? -1 : driver->getInstanceOwner()->getInstID());
+        writer.putI32(driver == nullptr ? -1 : pinIndex[driver]);
+        writer.putU32(net->getOutputPins().size());
+        for (Pin *pin : net->getOutputPins())
+        {
+            writer.putI32(pin->getInstanceOwner()->getInstID());
+            writer.putI32(pinIndex[pin]);
+        }
+    }
+
+    // 先写临时文件再改名，避免中断后留下不完整的快照
+    std::string tmpFile = snapFile + ".tmp";
+    std::ofstream outFile(tmpFile, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open())
+    {
+        std::cout << "Failed to open file: " << tmpFile << std::endl;
+        return false;
+    }
+    outFile.write(writer.data().data(), writer.data().size());
+    outFile.close();
+    if (!outFile || std::rename(tmpFile.c_str(), snapFile.c_str()) != 0)
+    {
+        std::cout << "Failed to write snapshot " << snapFile << std::endl;
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+    return true;
+}
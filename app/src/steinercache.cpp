@@ -0,0 +1,121 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include "global.h"
+#include "steinercache.h"
+
+SteinerCache glbSteinerCache;
+
+SteinerCache::SteinerCache(int numEntries)
+{
+    // 每个shard的槽位数取2的幂
+    slotsPerShard = 1;
+    while (slotsPerShard * NUM_SHARDS < numEntries)
+        slotsPerShard *= 2;
+    for (Shard &shard : shards)
+    {
+        shard.entries.resize(slotsPerShard);
+    }
+}
+
+int SteinerCache::getWireLength(const int *x, const int *y, int d)
+{
+    // 近似模型的结果不缓存，切换模型后不会取到旧值
+    if (d < 3 || d > MAX_DEGREE || !rsmt.isExact(d))
+    {
+        return rsmt.treeWireLength(x, y, d);
+    }
+
+    // 平移到原点，超出uint16范围的不缓存
+    int xMin = *std::min_element(x, x + d);
+    int yMin = *std::min_element(y, y + d);
+    uint16_t coords[2 * MAX_DEGREE];
+    uint64_t hash = 14695981039346656037ULL ^ d;
+    for (int i = 0; i < d; i++)
+    {
+        int dx = x[i] - xMin;
+        int dy = y[i] - yMin;
+        if (dx > 0xFFFF || dy > 0xFFFF)
+        {
+            return rsmt.treeWireLength(x, y, d);
+        }
+        coords[2 * i] = dx;
+        coords[2 * i + 1] = dy;
+        hash = (hash ^ ((uint64_t)dx << 16 | (uint64_t)dy)) * 1099511628211ULL;
+    }
+    // 0留给空槽位；shard取高位，槽位取低位，两者互不相关
+    if (hash == 0)
+        hash = 1;
+
+    Shard &shard = shards[(hash >> 32) % NUM_SHARDS];
+    Entry &entry = shard.entries[hash & (slotsPerShard - 1)];
+    size_t keyBytes = 2 * d * sizeof(uint16_t);
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (entry.hash == hash && entry.d == d && memcmp(entry.coords, coords, keyBytes) == 0)
+        {
+            shard.hits++;
+            return entry.length;
+        }
+        shard.misses++;
+    }
+
+    // 在锁外计算
+    int length = rsmt.treeWireLength(x, y, d);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    entry.hash = hash;
+    entry.d = d;
+    entry.length = length;
+    memcpy(entry.coords, coords, keyBytes);
+    return length;
+}
+
+void SteinerCache::clear()
+{
+    for (Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (Entry &entry : shard.entries)
+        {
+            entry.hash = 0;
+        }
+        shard.hits = 0;
+        shard.misses = 0;
+    }
+}
+
+uint64_t SteinerCache::getHits() const
+{
+    uint64_t hits = 0;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        hits += shard.hits;
+    }
+    return hits;
+}
+
+uint64_t SteinerCache::getMisses() const
+{
+    uint64_t misses = 0;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        misses += shard.misses;
+    }
+    return misses;
+}
+
+void SteinerCache::report() const
+{
+    uint64_t hits = getHits();
+    uint64_t misses = getMisses();
+    double hitRate = hits + misses == 0 ? 0.0 : 100.0 * hits / (hits + misses);
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << "[INFO] steiner cache hits: " << hits << ", misses: " << misses
+              << ", hit rate: " << std::fixed << std::setprecision(2) << hitRate << "%" << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include "global.h"
+#include "tilepin.h"
+
+TilePinCounter glbTilePinCounter;
+
+static bool isLutSeqInst(Instance *inst)
+{
+    const std::string &modelName = inst->getModelName();
+    return modelName.compare(0, 3, "LUT") == 0 || modelName.compare(0, 3, "SEQ") == 0;
+}
+
+bool TilePinCounter::NetTileCount::isInterTile() const
+{
+    auto it = sinkCount.find(driverTile);
+    int sinksInDriverTile = it == sinkCount.end() ? 0 : it->second;
+    return numSinks > sinksInDriverTile;
+}
+
+void TilePinCounter::clear()
+{
+    built = false;
+    nets.clear();
+    tileInput.clear();
+    tileOutput.clear();
+}
+
+void TilePinCounter::addSink(NetTileCount &net, int tile, bool isLutSeq)
+{
+    net.numSinks++;
+    net.sinkCount[tile]++;
+    if (isLutSeq)
+    {
+        net.lutSeqSinkCount[tile]++;
+    }
+}
+
+void TilePinCounter::build(bool isBaseline)
+{
+    clear();
+    this->isBaseline = isBaseline;
+    numRow = chip.getNumRow();
+    tileInput.assign(chip.getNumCol() * numRow, 0);
+    tileOutput.assign(chip.getNumCol() * numRow, 0);
+    for (auto &iter : glbNetMap)
+    {
+        Net *netPtr = iter.second;
+        NetTileCount &net = nets[iter.first];
+        Pin *inpin = netPtr->getInpin();
+        if (inpin != nullptr)
+        {
+            Instance *driver = inpin->getInstanceOwner();
+            net.driverTile = getTileIndex(isBaseline ? driver->getBaseLocation() : driver->getLocation());
+            net.driverLutSeq = isLutSeqInst(driver);
+        }
+        for (Pin *pin : netPtr->getOutputPins())
+        {
+            Instance *sink = pin->getInstanceOwner();
+            addSink(net, getTileIndex(isBaseline ? sink->getBaseLocation() : sink->getLocation()), isLutSeqInst(sink));
+        }
+        for (auto &it : net.lutSeqSinkCount)
+        {
+            if (it.first != net.driverTile)
+            {
+                tileInput[it.first]++;
+            }
+        }
+        addOutput(net);
+    }
+    built = true;
+}
+
+void TilePinCounter::removeOutput(const NetTileCount &net)
+{
+    if (net.driverLutSeq && net.isInterTile())
+    {
+        tileOutput[net.driverTile]--;
+    }
+}
+
+void TilePinCounter::addOutput(const NetTileCount &net)
+{
+    if (net.driverLutSeq && net.isInterTile())
+    {
+        tileOutput[net.driverTile]++;
+    }
+}
+
+void TilePinCounter::moveSink(NetTileCount &net, int fromTile, int toTile, bool isLutSeq)
+{
+    auto it = net.sinkCount.find(fromTile);
+    if (it == net.sinkCount.end())
+    {
+        std::cout << "Error: sink tile " << fromTile << " not found in tile pin counter" << std::endl;
+        return;
+    }
+    removeOutput(net);
+    if (--it->second == 0)
+    {
+        net.sinkCount.erase(fromTile);
+    }
+    net.sinkCount[toTile]++;
+    if (isLutSeq)
+    {
+        if (--net.lutSeqSinkCount[fromTile] == 0)
+        {
+            net.lutSeqSinkCount.erase(fromTile);
+            if (fromTile != net.driverTile)
+                tileInput[fromTile]--;
+        }
+        if (++net.lutSeqSinkCount[toTile] == 1 && toTile != net.driverTile)
+        {
+            tileInput[toTile]++;
+        }
+    }
+    addOutput(net);
+}
+
+void TilePinCounter::moveDriver(NetTileCount &net, int fromTile, int toTile)
+{
+    if (net.driverTile != fromTile)
+    {
+        // 该pin不是net的driver
+        return;
+    }
+    removeOutput(net);
+    // driver离开的tile中的sink变成了跨tile输入，进入的tile则相反
+    if (net.lutSeqSinkCount.count(fromTile))
+    {
+        tileInput[fromTile]++;
+    }
+    if (net.lutSeqSinkCount.count(toTile))
+    {
+        tileInput[toTile]--;
+    }
+    net.driverTile = toTile;
+    addOutput(net);
+}
+
+void TilePinCounter::moveInstance(bool isBaseline, Instance *inst, const std::tuple<int, int, int> &originLoc, const std::tuple<int, int, int> &loc)
+{
+    if (!isBuilt(isBaseline))
+    {
+        return;
+    }
+    int fromTile = getTileIndex(originLoc);
+    int toTile = getTileIndex(loc);
+    if (fromTile == toTile)
+    {
+        return;
+    }
+    bool isLutSeq = isLutSeqInst(inst);
+    for (int i = 0; i < inst->getNumInpins(); i++)
+    {
+        int netID = inst->getInpin(i)->getNetID();
+        auto it = nets.find(netID);
+        if (it != nets.end())
+        {
+            moveSink(it->second, fromTile, toTile, isLutSeq);
+        }
+    }
+    for (int i = 0; i < inst->getNumOutpins(); i++)
+    {
+        int netID = inst->getOutpin(i)->getNetID();
+        auto it = nets.find(netID);
+        if (it != nets.end())
+        {
+            moveDriver(it->second, fromTile, toTile);
+        }
+    }
+}
@@ -1,4 +1,10 @@
 #include <iostream>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "util.h"
 
 std::string unifyModelType(std::string inputType) {
@@ -9,4 +15,113 @@ std::string unifyModelType(std::string inputType) {
         trimmedType = subType;
     } 
     return trimmedType;
-}
\ No newline at end of file
+}
+
+MappedFile::MappedFile(const std::string &fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    length = st.st_size;
+    if (length > 0) {
+        void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            length = 0;
+            return;
+        }
+        madvise(ptr, length, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(ptr);
+    }
+    close(fd);
+    opened = true;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), length);
+    }
+}
+
+bool nextLine(const char *&cur, const char *end, const char *&lineBegin, const char *&lineEnd) {
+    if (cur >= end) {
+        return false;
+    }
+    lineBegin = cur;
+    const char *nl = static_cast<const char *>(memchr(cur, '\n', end - cur));
+    lineEnd = nl == nullptr ? end : nl;
+    cur = nl == nullptr ? end : nl + 1;
+    if (lineEnd > lineBegin && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+    return true;
+}
+
+bool nextToken(const char *&cur, const char *end, const char *&tokBegin, const char *&tokEnd) {
+    while (cur < end && isspace((unsigned char)*cur)) {
+        cur++;
+    }
+    if (cur >= end) {
+        return false;
+    }
+    tokBegin = cur;
+    while (cur < end && !isspace((unsigned char)*cur)) {
+        cur++;
+    }
+    tokEnd = cur;
+    return true;
+}
+
+bool parseInt(const char *begin, const char *end, int &value) {
+    bool negative = false;
+    if (begin < end && (*begin == '-' || *begin == '+')) {
+        negative = *begin == '-';
+        begin++;
+    }
+    if (begin >= end || !isdigit((unsigned char)*begin)) {
+        return false;
+    }
+    long long result = 0;
+    while (begin < end && isdigit((unsigned char)*begin)) {
+        result = result * 10 + (*begin - '0');
+        begin++;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// 从p开始匹配字母c后跟至少一位数字，成功时p移到数字之后
+static bool matchTagNumber(const char *&p, const char *end, char c, int &value) {
+    if (p >= end || *p != c || p + 1 >= end || !isdigit((unsigned char)p[1])) {
+        return false;
+    }
+    p++;
+    parseInt(p, end, value);
+    while (p < end && isdigit((unsigned char)*p)) {
+        p++;
+    }
+    return true;
+}
+
+bool parseLocationXYZ(const char *begin, const char *end, int &x, int &y, int &z) {
+    for (const char *p = begin; p < end; p++) {
+        const char *q = p;
+        if (matchTagNumber(q, end, 'X', x) && matchTagNumber(q, end, 'Y', y) && matchTagNumber(q, end, 'Z', z)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseIDAfterUnderscore(const char *begin, const char *end, int &id) {
+    const char *underscore = static_cast<const char *>(memchr(begin, '_', end - begin));
+    if (underscore == nullptr) {
+        return false;
+    }
+    return parseInt(underscore + 1, end, id);
+}
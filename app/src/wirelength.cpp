@@ -2,6 +2,7 @@
 #include "global.h"
 #include "wirelength.h"
 #include "rsmt.h"
+#include "netlistcsr.h"
 
 int reportWirelength()
 {
@@ -40,11 +41,24 @@ int reportWirelength()
   return 0;
 }
 
-//cjq modify 获取线长
-int getWirelength(bool isBaseline){
-  int totalCritWirelength = 0;
+// 计算netMap中所有非clock net的线长，有扁平netlist时直接读取
+static int getNetMapWirelength(std::map<int, Net *> &netMap, bool isBaseline)
+{
+  const FlatNetlist *flat = getFlatNetlist(netMap);
   int totalWirelength = 0;
-  for (auto iter : glbNetMap)
+  if (flat != nullptr)
+  {
+    for (int idx = 0; idx < flat->getNumNets(); idx++)
+    {
+      if (!flat->isClock(idx))
+      {
+        totalWirelength += flat->getNetWireLength(idx, isBaseline);
+      }
+    }
+    return totalWirelength;
+  }
+  int totalCritWirelength = 0;
+  for (auto &iter : netMap)
   {
     Net *net = iter.second;
     if (net->isClock())
@@ -60,9 +74,25 @@ int getWirelength(bool isBaseline){
   return totalWirelength;
 }
 
+// 单个net的线长（关键+非关键）
+static int getNetWirelength(const FlatNetlist *flat, Net *net, bool isBaseline)
+{
+  int idx = flat != nullptr ? flat->getNetIndex(net->getId()) : -1;
+  if (idx != -1)
+  {
+    return flat->getNetWireLength(idx, isBaseline);
+  }
+  return net->getCritWireLength(isBaseline) + net->getNonCritWireLength(isBaseline);
+}
+
+//cjq modify 获取线长
+int getWirelength(bool isBaseline){
+  return getNetMapWirelength(glbNetMap, isBaseline);
+}
+
 // cjq modify 获取inst相关net的线长
 int getRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId){  
-  int totalCritWirelength = 0;
+  const FlatNetlist *flat = getFlatNetlist(glbNetMap);
   int totalWirelength = 0;
   for (int i : instRelatedNetId)
   {
@@ -72,21 +102,30 @@ int getRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId)
       {
         continue;
       }
-      totalCritWirelength += net->getCritWireLength(isBaseline);
-      totalWirelength += net->getNonCritWireLength(isBaseline);
+      totalWirelength += getNetWirelength(flat, net, isBaseline);
     }
     else{
       std::cout<<"getRelatedWirelength can not find this netId:"<<i<<std::endl;
     }
   }
 
-  // append critical wirelength to total wirelength
-  totalWirelength += totalCritWirelength;
   return totalWirelength;
 }
 // cjq modify 获取半周线长
 int getHPWL(bool isBaseline){
   int HPWL = 0;
+  const FlatNetlist *flat = getFlatNetlist(glbNetMap);
+  if (flat != nullptr)
+  {
+    for (int idx = 0; idx < flat->getNumNets(); idx++)
+    {
+      if (!flat->isClock(idx))
+      {
+        HPWL += flat->getNetHPWL(idx, isBaseline);
+      }
+    }
+    return HPWL;
+  }
   for (auto iter : glbNetMap)
   {
     Net *net = iter.second;
@@ -94,9 +133,7 @@ int getHPWL(bool isBaseline){
     {
       continue;
     }
-    //记录引脚位置
-    std::set<int> locXSet;  // (*locXSet.rbegin()) 最大值  (*locXSet.begin()) 最小值
-    std::set<int> locYSet;
+    //记录引脚位置的最大最小值
     int x,y,z;
     //inpin
     Pin* inpin = net->getInpin();
@@ -107,8 +144,7 @@ int getHPWL(bool isBaseline){
     else{
       std::tie(x,y,z) = inst->getLocation();
     }
-    locXSet.insert(x);
-    locYSet.insert(y);
+    int xMin = x, xMax = x, yMin = y, yMax = y;
     //outpin
     std::list<Pin*>& outputPin = net->getOutputPins();
     for(auto pin : outputPin){
@@ -119,11 +155,13 @@ int getHPWL(bool isBaseline){
       else{
         std::tie(x,y,z) = inst->getLocation();
       }
-      locXSet.insert(x);
-      locYSet.insert(y);
+      xMin = std::min(xMin, x);
+      xMax = std::max(xMax, x);
+      yMin = std::min(yMin, y);
+      yMax = std::max(yMax, y);
     }
     //计算一个net的半周线长
-    int oneNetHPWL = (*locXSet.rbegin()) - (*locXSet.begin()) + (*locYSet.rbegin()) - (*locYSet.begin());
+    int oneNetHPWL = xMax - xMin + yMax - yMin;
     HPWL += oneNetHPWL;
   }
 
@@ -133,28 +171,13 @@ int getHPWL(bool isBaseline){
 
 //wbx 获取pack线长
 int getPackWirelength(bool isBaseline){
-  int totalCritWirelength = 0;
-  int totalWirelength = 0;
-  for (auto iter : glbPackNetMap)
-  {
-    Net *net = iter.second;
-    if (net->isClock())
-    {
-      continue;
-    }
-    totalCritWirelength += net->getCritWireLength(isBaseline);
-    totalWirelength += net->getNonCritWireLength(isBaseline);
-  }
-
-  // append critical wirelength to total wirelength
-  totalWirelength += totalCritWirelength;
-  return totalWirelength;
+  return getNetMapWirelength(glbPackNetMap, isBaseline);
 }
 
 
 // cjq modify 获取inst相关net的线长
 int getPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNetId){  
-  int totalCritWirelength = 0;
+  const FlatNetlist *flat = getFlatNetlist(glbPackNetMap);
   int totalWirelength = 0;
   for (int i : instRelatedNetId)
   {
@@ -165,15 +188,177 @@ int getPackRelatedWirelength(bool isBaseline, const std::set<int>& instRelatedNe
         continue;
       }
       
-      totalCritWirelength += net->getCritWireLength(isBaseline);
-      totalWirelength += net->getNonCritWireLength(isBaseline);
+      totalWirelength += getNetWirelength(flat, net, isBaseline);
     }
     else{
       std::cout<<"getPackRelatedWirelength can not find this netId:"<<i<<std::endl;
     }
   }
 
-  // append critical wirelength to total wirelength
-  totalWirelength += totalCritWirelength;
   return totalWirelength;
-}
\ No newline at end of file
+}
+
+// 单个net重新计算线长，暂存在pendingWL中
+static int evalNetWirelength(const FlatNetlist *flat, Net *net, bool isBaseline)
+{
+  int idx = flat != nullptr ? flat->getNetIndex(net->getId()) : -1;
+  if (idx == -1)
+  {
+    return net->evalWireLength(isBaseline);
+  }
+  int wirelength = flat->getNetWireLength(idx, isBaseline);
+  net->setPendingWireLength(isBaseline, wirelength);
+  return wirelength;
+}
+
+/*
+带缓存的相关线长，SA每次移动的用法：
+  before = getCachedRelatedWirelength  移动前直接读缓存
+  after  = evalRelatedWirelength       移动后重新计算，暂存不写缓存
+  接受移动 commitRelatedWirelength；拒绝移动复原位置即可，缓存仍然有效
+*/
+static int getCachedNetMapWirelength(std::map<int, Net *> &netMap, bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  const FlatNetlist *flat = getFlatNetlist(netMap);
+  int totalWirelength = 0;
+  for (int i : instRelatedNetId)
+  {
+    auto it = netMap.find(i);
+    if (it == netMap.end())
+    {
+      std::cout << "getCachedRelatedWirelength can not find this netId:" << i << std::endl;
+      continue;
+    }
+    if (it->second->isClock())
+    {
+      continue;
+    }
+    Net *net = it->second;
+    if (!net->isWireLengthCached(isBaseline))
+    {
+      evalNetWirelength(flat, net, isBaseline);
+      net->commitWireLength(isBaseline);
+    }
+    totalWirelength += net->getCachedWireLength(isBaseline);
+  }
+  return totalWirelength;
+}
+
+static int evalNetMapWirelength(std::map<int, Net *> &netMap, bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  const FlatNetlist *flat = getFlatNetlist(netMap);
+  int totalWirelength = 0;
+  for (int i : instRelatedNetId)
+  {
+    auto it = netMap.find(i);
+    if (it == netMap.end())
+    {
+      std::cout << "evalRelatedWirelength can not find this netId:" << i << std::endl;
+      continue;
+    }
+    if (it->second->isClock())
+    {
+      continue;
+    }
+    totalWirelength += evalNetWirelength(flat, it->second, isBaseline);
+  }
+  return totalWirelength;
+}
+
+static void commitNetMapWirelength(std::map<int, Net *> &netMap, bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  for (int i : instRelatedNetId)
+  {
+    auto it = netMap.find(i);
+    if (it != netMap.end() && !it->second->isClock())
+    {
+      it->second->commitWireLength(isBaseline);
+    }
+  }
+}
+
+int getCachedRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  return getCachedNetMapWirelength(glbNetMap, isBaseline, instRelatedNetId);
+}
+
+int evalRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  return evalNetMapWirelength(glbNetMap, isBaseline, instRelatedNetId);
+}
+
+void commitRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  commitNetMapWirelength(glbNetMap, isBaseline, instRelatedNetId);
+}
+
+int getCachedFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd)
+{
+  int totalWirelength = 0;
+  for (const int *n = netsBegin; n != netsEnd; ++n)
+  {
+    if (flat.isClock(*n))
+    {
+      continue;
+    }
+    Net *net = flat.getNet(*n);
+    if (!net->isWireLengthCached(isBaseline))
+    {
+      net->setPendingWireLength(isBaseline, flat.getNetWireLength(*n, isBaseline));
+      net->commitWireLength(isBaseline);
+    }
+    totalWirelength += net->getCachedWireLength(isBaseline);
+  }
+  return totalWirelength;
+}
+
+int evalFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd)
+{
+  int totalWirelength = 0;
+  for (const int *n = netsBegin; n != netsEnd; ++n)
+  {
+    if (flat.isClock(*n))
+    {
+      continue;
+    }
+    int wirelength = flat.getNetWireLength(*n, isBaseline);
+    flat.getNet(*n)->setPendingWireLength(isBaseline, wirelength);
+    totalWirelength += wirelength;
+  }
+  return totalWirelength;
+}
+
+void commitFlatWirelength(const FlatNetlist &flat, bool isBaseline, const int *netsBegin, const int *netsEnd)
+{
+  for (const int *n = netsBegin; n != netsEnd; ++n)
+  {
+    if (!flat.isClock(*n))
+    {
+      flat.getNet(*n)->commitWireLength(isBaseline);
+    }
+  }
+}
+
+int getCachedPackRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  return getCachedNetMapWirelength(glbPackNetMap, isBaseline, instRelatedNetId);
+}
+
+int evalPackRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  return evalNetMapWirelength(glbPackNetMap, isBaseline, instRelatedNetId);
+}
+
+void commitPackRelatedWirelength(bool isBaseline, const std::set<int> &instRelatedNetId)
+{
+  commitNetMapWirelength(glbPackNetMap, isBaseline, instRelatedNetId);
+}
+
+// 布局在SA之外被修改后（读入、打包、恢复映射）需要清空缓存
+void invalidateWirelengthCache(std::map<int, Net *> &netMap)
+{
+  for (auto &iter : netMap)
+  {
+    iter.second->invalidateWireLength();
+  }
+}
@@ -15,6 +15,7 @@
 #include "method.h"
 #include "test.h"
 #include "arbsa.h"
+#include "snapshot.h"
 
 #include "global_placement_sa.h"
 
@@ -54,30 +55,53 @@ int main(int argc, char *argv[])
     // std::string libFile = "/home/public/Arch/fpga.lib";
     // std::string sclFile = "/home/public/Arch/fpga.scl";
     // std::string clkFile = "/home/public/Arch/fpga.clk";
-    if (readAndCreateLib(libFile) == false)
-    {
-        std::cout << "Failed to create library" << std::endl;
-    }
-    if (chip.readArch(sclFile, clkFile) == false)
-    {
-        std::cout << "Failed to read sclFile and clkFile" << std::endl;
-    }
-    std::cout << "  Successfully read Arch files." << std::endl;
 
-    // 读取case
-    if (!readInputNodes(nodesFile))
-    {
-        std::cout << "Failed to read nodesFile" << std::endl;
-    }
-    if (!readInputNets(netsFile))
+    // 输入文件未变化时直接从快照重建，跳过文本解析
+    std::vector<std::string> inputFiles = {libFile, sclFile, clkFile, nodesFile, netsFile, timingFile};
+    std::string snapFile = nodesFile + ".snap";
+    if (loadSnapshot(snapFile, inputFiles))
     {
-        std::cout << "Failed to read netsFile" << std::endl;
+        std::cout << "  Successfully loaded snapshot " << snapFile << std::endl;
     }
-    if (!readInputTiming(timingFile))
+    else
     {
-        std::cout << "Failed to read timingFile" << std::endl;
+        bool readOK = true;
+        if (readAndCreateLib(libFile) == false)
+        {
+            std::cout << "Failed to create library" << std::endl;
+            readOK = false;
+        }
+        if (chip.readArch(sclFile, clkFile) == false)
+        {
+            std::cout << "Failed to read sclFile and clkFile" << std::endl;
+            readOK = false;
+        }
+        std::cout << "  Successfully read Arch files." << std::endl;
+
+        // 读取case
+        if (!readInputNodes(nodesFile))
+        {
+            std::cout << "Failed to read nodesFile" << std::endl;
+            readOK = false;
+        }
+        if (!readInputNets(netsFile))
+        {
+            std::cout << "Failed to read netsFile" << std::endl;
+            readOK = false;
+        }
+        if (!readInputTiming(timingFile))
+        {
+            std::cout << "Failed to read timingFile" << std::endl;
+            readOK = false;
+        }
+        std::cout << "  Successfully read design files." << std::endl;
+
+        // 只缓存完整读入的设计
+        if (readOK && saveSnapshot(snapFile, inputFiles))
+        {
+            std::cout << "  Saved snapshot " << snapFile << std::endl;
+        }
     }
-    std::cout << "  Successfully read design files." << std::endl;
 
     // 设置isPLB数组
     setIsPLB();
@@ -85,13 +109,27 @@ int main(int argc, char *argv[])
     // 基于baseline修改
     bool isBaseline = false;
     bool isSeqPack = false;
+    bool isMtx = false; // 是否使用多线程模拟退火
+    bool isPT = false;  // 是否使用并行回火的模拟退火
+    int mtxThreads = 0; // 多线程模拟退火的线程数，<=0时按核数
+    // config.json中设置了mtxThreads时，在baseline上运行多线程模拟退火
+    std::string mtxThreadsValue = getValue(jsonContent, "mtxThreads");
+    if (!mtxThreadsValue.empty())
+    {
+        isBaseline = true;
+        isMtx = true;
+        mtxThreads = std::atoi(mtxThreadsValue.c_str());
+    }
 
     reportDesignStatistics();
 
     if (isBaseline)
     {
         setPinDensityMapAndTopValues();
-        arbsa(isBaseline, nodesFile);
+        if (isMtx)
+            arbsaMtx(isBaseline, mtxThreads);
+        else
+            arbsa(isBaseline, nodesFile);
         
         // free memory before exit
         for (auto &lib : glbLibMap)
@@ -114,7 +152,10 @@ int main(int argc, char *argv[])
         matchLUTPairs(glbInstMap, true, isSeqPack); // 打包代码
         printInstanceInformation();
         // 模拟退火
-        newArbsa(isBaseline, isSeqPack);
+        if (isPT)
+            newArbsaPT(isBaseline, isSeqPack);
+        else
+            newArbsa(isBaseline, isSeqPack);
     }
     // 生成结果
     generateOutputFile(isBaseline, outFile);
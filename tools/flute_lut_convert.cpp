@@ -0,0 +1,91 @@
+/*
+FLUTE查找表转换工具，只需运行一次
+  flute_lut_convert POWV9.dat POST9.dat flute9.lut         生成二进制镜像，放在eda240819旁边即可
+  flute_lut_convert --cpp POWV9.dat POST9.dat lut.cpp      生成嵌入用的源文件（FLUTE_EMBED_LUT）
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "rsmt.h"
+
+static bool writeCppSource(const std::string &image, const std::string &fileName)
+{
+    std::ofstream out(fileName);
+    if (!out.is_open())
+    {
+        std::cout << "Failed to open file: " << fileName << std::endl;
+        return false;
+    }
+    static const char hexDigits[] = "0123456789abcdef";
+    out << "// generated by flute_lut_convert, do not edit\n";
+    out << "#include \"rsmt.h\"\n\n";
+    // 字符串字面量比逐字节的初始化列表编译快得多，末尾多一个'\0'
+    out << "alignas(8) const unsigned char fluteLutImage[" << image.size() + 1 << "] =\n\"";
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        unsigned char c = image[i];
+        out << "\\x" << hexDigits[c >> 4] << hexDigits[c & 15];
+        if (i % 64 == 63)
+        {
+            out << "\"\n\"";
+        }
+    }
+    out << "\";\n";
+    out << "const unsigned long fluteLutImageSize = " << image.size() << "UL;\n";
+    out.close();
+    return !out.fail();
+}
+
+int main(int argc, char *argv[])
+{
+    bool isCpp = argc == 5 && std::string(argv[1]) == "--cpp";
+    if (argc != 4 && !isCpp)
+    {
+        std::cout << "Usage: " << argv[0] << " [--cpp] POWV9.dat POST9.dat output" << std::endl;
+        return 1;
+    }
+    int argBase = isCpp ? 2 : 1;
+    std::string powvFile = argv[argBase];
+    std::string postFile = argv[argBase + 1];
+    std::string outFile = argv[argBase + 2];
+
+    RecSteinerMinTree steiner(false);
+    if (!steiner.loadLUTText(powvFile, postFile))
+    {
+        std::cout << "Failed to read FLUTE LUT files" << std::endl;
+        return 1;
+    }
+    std::string image;
+    if (!steiner.writeLUTImage(image))
+    {
+        std::cout << "Failed to build FLUTE LUT image" << std::endl;
+        return 1;
+    }
+
+    if (isCpp)
+    {
+        if (!writeCppSource(image, outFile))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        std::ofstream out(outFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cout << "Failed to open file: " << outFile << std::endl;
+            return 1;
+        }
+        out.write(image.data(), image.size());
+        out.close();
+        if (out.fail())
+        {
+            std::cout << "Failed to write " << outFile << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "  Wrote FLUTE LUT image " << outFile << " (" << image.size() << " bytes)" << std::endl;
+    return 0;
+}